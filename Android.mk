@@ -2,10 +2,15 @@ LOCAL_PATH := $(call my-dir)
 include $(CLEAR_VARS)
 
 iperf_SOURCES = \
+    src/Affinity.c \
+    src/BufferPool.c \
     src/Client.cpp \
+    src/ClientEngine.cpp \
     src/Extractor.c \
     src/gnu_getopt_long.c \
     src/gnu_getopt.c \
+    src/IOUring.c \
+    src/KernelStamp.c \
     src/Launch.cpp \
     src/Listener.cpp \
     src/List.cpp \
@@ -16,9 +21,12 @@ iperf_SOURCES = \
     src/ReportDefault.c \
     src/Reporter.c \
     src/Server.cpp \
+    src/ServerEngine.cpp \
     src/service.c \
     src/Settings.cpp \
     src/SocketAddr.c \
+    src/Trace.c \
+    src/Verify.c \
     src/sockets.c \
     src/stdio.c \
     src/tcp_window_size.c \
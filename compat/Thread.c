@@ -255,6 +255,11 @@ thread_run_wrapper( void* paramPtr ) {
                 // Decrement the non-terminating thread count
                 thread_unregister_nonterm();
             } break;
+        case kMode_Worker:
+            {
+                /* Spawn a --workers server thread with these settings */
+                worker_spawn( thread );
+            } break;
         default:
             {
                 FAIL(1, "Unknown Thread Type!\n", thread);
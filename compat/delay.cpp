@@ -55,22 +55,62 @@
 #include "delay.hpp"
 
 /* -------------------------------------------------------------------
- * A micro-second delay function. This uses gettimeofday (underneith
- * the Timestamp) which has a resolution of upto microseconds. I've
- * found it's good to within about 10 usecs.
- * I used to do calibration, but iperf automatically adjusts itself
- * so that isn't necesary, and it causes some problems if the
- * calibration adjustment is larger than your sleep time.
+ * A micro-second delay function. It used to spin on gettimeofday for
+ * the whole delay, which keeps a core busy even for a 1 Mbit/sec
+ * stream. Now it sleeps until shortly before an absolute deadline on
+ * the monotonic clock (so the sleep does not drift with the time it
+ * takes to wake up) and spins only for the last stats->spin usecs,
+ * where the scheduler is too coarse to be trusted.
  * ------------------------------------------------------------------- */
 
-void delay_loop( unsigned long usec ) {
-#if 0
-    Timestamp end;
-    end.add( usec * 1e-6 );
+#if defined(HAVE_CLOCK_GETTIME) && defined(CLOCK_MONOTONIC)
+
+static inline double delay_now( struct timespec *ts ) {
+    clock_gettime( CLOCK_MONOTONIC, ts );
+    return ts->tv_sec * 1e6 + ts->tv_nsec / 1e3;
+}
+
+void delay_loop_stats( unsigned long usec, delay_stats *stats ) {
+    struct timespec ts;
+    double now = delay_now( &ts );
+    double end = now + usec;
+    long spin = (stats != NULL ? stats->spin : kDefault_DelaySpin);
+
+    if ( (long) usec > spin ) {
+        // sleep up to the point where spinning takes over
+        unsigned long wake = usec - spin;
+        ts.tv_sec  += wake / 1000000;
+        ts.tv_nsec += (wake % 1000000) * 1000;
+        if ( ts.tv_nsec >= 1000000000 ) {
+            ts.tv_nsec -= 1000000000;
+            ts.tv_sec++;
+        }
+#ifdef HAVE_CLOCK_NANOSLEEP
+        while ( clock_nanosleep( CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL ) == EINTR ) {
+            // a signal (e.g. the -t alarm) woke us early, sleep on
+        }
+#else
+        usleep( wake );
+#endif
+    }
+    while ( (now = delay_now( &ts )) < end ) {
+        // spin out the remainder
+    }
+
+    if ( stats != NULL ) {
+        stats->count++;
+        stats->late += now - end;
+        if ( now - end > stats->late_max ) {
+            stats->late_max = now - end;
+        }
+    }
+}
 
-    Timestamp now;
 #else
+
+void delay_loop_stats( unsigned long usec, delay_stats *stats ) {
     Timestamp now;
+    long spin = (stats != NULL ? stats->spin : kDefault_DelaySpin);
     long esec=now.getSecs(), eusec=now.getUsecs();
     if (usec >=1000000) {
         esec+= usec/1000000;
@@ -83,8 +123,47 @@ void delay_loop( unsigned long usec ) {
         ++esec;
     }
     Timestamp end(esec, eusec);
-#endif 
+
+#ifdef HAVE_USLEEP
+    if ( (long) usec > spin ) {
+        usleep( usec - spin );
+    }
+#endif
     while ( now.before( end ) ) {
         now.setnow();
     }
+
+    if ( stats != NULL ) {
+        double late = now.subUsec( end );
+        stats->count++;
+        stats->late += late;
+        if ( late > stats->late_max ) {
+            stats->late_max = late;
+        }
+    }
+}
+
+#endif
+
+void delay_loop( unsigned long usec ) {
+    delay_loop_stats( usec, NULL );
+}
+
+/* -------------------------------------------------------------------
+ * CPU time in seconds used so far by the calling thread, or by the
+ * whole process where per thread clocks are not available. Returns
+ * a negative value if neither can be read.
+ * ------------------------------------------------------------------- */
+double delay_cputime( void ) {
+#if defined(HAVE_CLOCK_GETTIME) && defined(CLOCK_THREAD_CPUTIME_ID)
+    struct timespec ts;
+    if ( clock_gettime( CLOCK_THREAD_CPUTIME_ID, &ts ) == 0 ) {
+        return ts.tv_sec + ts.tv_nsec / 1e9;
+    }
+#endif
+    clock_t cpu = clock();
+    if ( cpu == (clock_t) -1 ) {
+        return -1;
+    }
+    return (double) cpu / CLOCKS_PER_SEC;
 }
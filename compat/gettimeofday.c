@@ -101,3 +101,25 @@ int gettimeofday( struct timeval* tv, void* timezone ) {
     #endif
 
 #endif /* HAVE_GETTIMEOFDAY */
+
+#include "headers.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+void gettime_monotonic( struct timespec* ts ) {
+    struct timeval tv;
+#if defined(HAVE_CLOCK_GETTIME) && defined(CLOCK_MONOTONIC)
+    if ( clock_gettime( CLOCK_MONOTONIC, ts ) == 0 ) {
+        return;
+    }
+#endif
+    gettimeofday( &tv, NULL );
+    ts->tv_sec  = tv.tv_sec;
+    ts->tv_nsec = tv.tv_usec * 1000;
+}
+
+#ifdef __cplusplus
+} /* end extern "C" */
+#endif
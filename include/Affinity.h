@@ -0,0 +1,98 @@
+/*--------------------------------------------------------------- 
+ * Copyright (c) 1999,2000,2001,2002,2003                              
+ * The Board of Trustees of the University of Illinois            
+ * All Rights Reserved.                                           
+ *--------------------------------------------------------------- 
+ * Permission is hereby granted, free of charge, to any person    
+ * obtaining a copy of this software (Iperf) and associated       
+ * documentation files (the "Software"), to deal in the Software  
+ * without restriction, including without limitation the          
+ * rights to use, copy, modify, merge, publish, distribute,        
+ * sublicense, and/or sell copies of the Software, and to permit     
+ * persons to whom the Software is furnished to do
+ * so, subject to the following conditions: 
+ *
+ *     
+ * Redistributions of source code must retain the above 
+ * copyright notice, this list of conditions and 
+ * the following disclaimers. 
+ *
+ *     
+ * Redistributions in binary form must reproduce the above 
+ * copyright notice, this list of conditions and the following 
+ * disclaimers in the documentation and/or other materials 
+ * provided with the distribution. 
+ * 
+ *     
+ * Neither the names of the University of Illinois, NCSA, 
+ * nor the names of its contributors may be used to endorse 
+ * or promote products derived from this Software without
+ * specific prior written permission. 
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, 
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES 
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND 
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE CONTIBUTORS OR COPYRIGHT 
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, 
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, 
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE. 
+ * ________________________________________________________________
+ * National Laboratory for Applied Network Research 
+ * National Center for Supercomputing Applications 
+ * University of Illinois at Urbana-Champaign 
+ * http://www.ncsa.uiuc.edu
+ * ________________________________________________________________ 
+ * Affinity.h
+ * -------------------------------------------------------------------
+ * CPU lists for --affinity and --reporter-affinity, pinning threads
+ * to them, and placing a thread's buffers on the NUMA node of the
+ * CPU it is pinned to.
+ * ------------------------------------------------------------------- */
+
+#ifndef _AFFINITY_H
+#define _AFFINITY_H
+
+#include "headers.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define AFFINITY_MAX_CPUS 1024
+
+    /**
+     * Parse a CPU list such as "0-3,8,10-11", or "rr" for every CPU
+     * the process may run on, in order. Threads take the CPUs of
+     * the list round-robin.
+     * @return the number of CPUs, 0 if the list is invalid
+     */
+    int Affinity_Parse( const char *list, int *cpus, int max );
+
+    /*
+     * Write a CPU list back out, with runs shortened to ranges
+     */
+    void Affinity_Format( const int *cpus, int count, char *out, int len );
+
+    /**
+     * Pin the calling thread to the CPUs given
+     * @return 0, or an errno
+     */
+    int Affinity_Pin( const int *cpus, int count );
+
+    /*
+     * NUMA node of a CPU, or -1 if unknown
+     */
+    int Affinity_Node( int cpu );
+
+    /*
+     * Move the whole pages of len bytes at addr to a NUMA node and
+     * keep them there, quietly doing nothing if that is not possible
+     */
+    void Affinity_Place( void *addr, size_t len, int node );
+
+#ifdef __cplusplus
+} /* end extern "C" */
+#endif
+
+#endif
@@ -0,0 +1,109 @@
+/*--------------------------------------------------------------- 
+ * Copyright (c) 1999,2000,2001,2002,2003                              
+ * The Board of Trustees of the University of Illinois            
+ * All Rights Reserved.                                           
+ *--------------------------------------------------------------- 
+ * Permission is hereby granted, free of charge, to any person    
+ * obtaining a copy of this software (Iperf) and associated       
+ * documentation files (the "Software"), to deal in the Software  
+ * without restriction, including without limitation the          
+ * rights to use, copy, modify, merge, publish, distribute,        
+ * sublicense, and/or sell copies of the Software, and to permit     
+ * persons to whom the Software is furnished to do
+ * so, subject to the following conditions: 
+ *
+ *     
+ * Redistributions of source code must retain the above 
+ * copyright notice, this list of conditions and 
+ * the following disclaimers. 
+ *
+ *     
+ * Redistributions in binary form must reproduce the above 
+ * copyright notice, this list of conditions and the following 
+ * disclaimers in the documentation and/or other materials 
+ * provided with the distribution. 
+ * 
+ *     
+ * Neither the names of the University of Illinois, NCSA, 
+ * nor the names of its contributors may be used to endorse 
+ * or promote products derived from this Software without
+ * specific prior written permission. 
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, 
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES 
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND 
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE CONTIBUTORS OR COPYRIGHT 
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, 
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, 
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE. 
+ * ________________________________________________________________
+ * National Laboratory for Applied Network Research 
+ * National Center for Supercomputing Applications 
+ * University of Illinois at Urbana-Champaign 
+ * http://www.ncsa.uiuc.edu
+ * ________________________________________________________________ 
+ * BufferPool.h
+ * -------------------------------------------------------------------
+ * Aligned data buffers for the clients, servers and listeners.
+ * Buffers of a page or more start on a page, smaller ones on a cache
+ * line. They are cut from 2 MB chunks, which --hugepages backs with
+ * huge pages, and are reused once returned. TCP servers, which throw
+ * the data away, share discard buffers so each connection costs no
+ * buffer memory of its own.
+ * ------------------------------------------------------------------- */
+
+#ifndef _BUFFERPOOL_H
+#define _BUFFERPOOL_H
+
+#include "headers.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define POOL_CACHE_LINE 64
+#define POOL_CHUNK      (2 * 1024 * 1024)
+
+/*
+ * What --hugepages got
+ */
+#define POOL_HUGE_NONE        0
+#define POOL_HUGE_TRANSPARENT 1     // madvise(MADV_HUGEPAGE)
+#define POOL_HUGE_EXPLICIT    2     // MAP_HUGETLB
+
+    /**
+     * Called once, before any buffer is handed out
+     * @arg hugepages   back the chunks with huge pages
+     */
+    void BufferPool_Initialize( int hugepages );
+
+    /*
+     * A buffer of at least size bytes, for the caller alone
+     */
+    char* BufferPool_Get( size_t size );
+
+    /*
+     * A discard buffer of at least size bytes, shared with other
+     * receivers whose data is never looked at. Threads on different
+     * CPUs get different buffers so they do not fight over the lines,
+     * each kept on its CPU's NUMA node. A cpu of -1 means unknown.
+     */
+    char* BufferPool_GetShared( size_t size, int cpu );
+
+    /*
+     * Give back a buffer from either of the above, NULL is ignored
+     */
+    void BufferPool_Put( char *buf );
+
+    /*
+     * POOL_HUGE_NONE, POOL_HUGE_TRANSPARENT or POOL_HUGE_EXPLICIT
+     * for the chunks mapped so far
+     */
+    int BufferPool_HugePages( void );
+
+#ifdef __cplusplus
+} /* end extern "C" */
+#endif
+
+#endif
@@ -56,6 +56,7 @@
 
 #include "Settings.hpp"
 #include "Timestamp.hpp"
+#include "delay.hpp"
 
 /* ------------------------------------------------------------------- */
 class Client {
@@ -72,6 +73,20 @@ public:
     // TCP specific version of above
     void RunTCP( void );
 
+    // UDP version of above that sends datagrams in batches
+    void RunUDPBatch( void );
+
+    // UDP version of above that sends bursts of datagrams (frames)
+    // on a fixed schedule
+    void RunIsochronous( void );
+
+    // UDP version of above that replays the sizes and times
+    // of the packets in a trace file
+    void RunTrace( void );
+
+    // version of above that queues its writes on an io_uring
+    void RunURing( void );
+
     void InitiateServer();
 
     // UDP / TCP
@@ -79,15 +94,67 @@ public:
         
     void write_UDP_FIN( );
 
+    // close the report and end a UDP test with the FIN
+    void Finish( ReportStruct *reportstruct );
+    void StampFIN( ReportStruct *reportstruct );
+
     // client connect
     void Connect( );
 
+    // MSG_ZEROCOPY support for RunTCP
+    char* ZeroCopyBuffer( void );
+    void ZeroCopyReap( bool wait );
+
+    // hand the pacing accuracy and CPU use to the final report
+    void PacingReport( void );
+
+    // --tx-timestamps support for Run
+    void TxStampStart( void );
+    void TxStampWrite( void );
+    void TxStampReap( void );
+    double TxStampDelay( void );
+
+    // one stream of a --workers thread, which calls StreamWrite
+    // whenever the socket is writable and the pacer allows, and
+    // StreamFIN until the server acknowledges a UDP stream's end
+    void StreamStart( void );
+    long StreamWrite( int len );
+    bool StreamDone( void );
+    bool StreamEnd( void );
+    bool StreamFIN( bool readable );
+    void StreamClose( void );
+
 protected:
     thread_Settings *mSettings;
     char* mBuf;
     Timestamp mEndTime;
     Timestamp lastPacketTime;
 
+    // pool of send buffers for --zerocopy, a buffer may not be
+    // rewritten until the kernel releases the send that used it
+    char** mZCPool;
+    u_int32_t* mZCPoolSeq;          // last send from each buffer, 1-based
+    int mZCNext;
+    u_int32_t mZCSent;              // MSG_ZEROCOPY sends issued
+    u_int32_t mZCDone;              // sends the kernel has released
+    int mZCZeroCopy;
+    int mZCCopied;
+
+    delay_stats mDelay;             // -b pacing accuracy
+    double mCPUStart;               // thread CPU seconds at the start
+
+    ReportStruct *mStreamReport;    // --workers stream state
+    max_size_t mStreamTotal;
+    int mStreamFINs;                // UDP FINs sent awaiting the server's ack
+
+    // --tx-timestamps, the wall clock before each of the last
+    // kTxStamp_Slots writes and the stamped delays not yet reported
+    struct timespec *mTxSent;
+    u_int32_t mTxNext;              // number the kernel gives the next write
+    double *mTxDelays;
+    int mTxHead;
+    int mTxCount;
+
 }; // end class Client
 
 #endif // CLIENT_H
@@ -0,0 +1,135 @@
+/*--------------------------------------------------------------- 
+ * Copyright (c) 1999,2000,2001,2002,2003                       
+ * The Board of Trustees of the University of Illinois            
+ * All Rights Reserved.                                           
+ *--------------------------------------------------------------- 
+ * Permission is hereby granted, free of charge, to any person    
+ * obtaining a copy of this software (Iperf) and associated       
+ * documentation files (the "Software"), to deal in the Software  
+ * without restriction, including without limitation the          
+ * rights to use, copy, modify, merge, publish, distribute,        
+ * sublicense, and/or sell copies of the Software, and to permit     
+ * persons to whom the Software is furnished to do
+ * so, subject to the following conditions: 
+ *
+ *     
+ * Redistributions of source code must retain the above 
+ * copyright notice, this list of conditions and 
+ * the following disclaimers. 
+ *
+ *     
+ * Redistributions in binary form must reproduce the above 
+ * copyright notice, this list of conditions and the following 
+ * disclaimers in the documentation and/or other materials 
+ * provided with the distribution. 
+ * 
+ *     
+ * Neither the names of the University of Illinois, NCSA, 
+ * nor the names of its contributors may be used to endorse 
+ * or promote products derived from this Software without
+ * specific prior written permission. 
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, 
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES 
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND 
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE CONTIBUTORS OR COPYRIGHT 
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, 
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, 
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE. 
+ * ________________________________________________________________
+ * National Laboratory for Applied Network Research 
+ * National Center for Supercomputing Applications 
+ * University of Illinois at Urbana-Champaign 
+ * http://www.ncsa.uiuc.edu
+ * ________________________________________________________________ 
+ *
+ * ClientEngine.hpp
+ * -------------------------------------------------------------------
+ * Event driven client for --workers. Instead of a thread per stream,
+ * each worker thread drives many streams on non-blocking sockets
+ * from one epoll set. A stream is written to while its socket is
+ * writable and its token bucket allows; a stream that must wait for
+ * the pacer sits in a timer heap with its EPOLLOUT interest turned
+ * off, so idle streams cost nothing.
+ * ------------------------------------------------------------------- */
+
+#ifndef CLIENTENGINE_H
+#define CLIENTENGINE_H
+
+#include "headers.h"
+#include "Settings.hpp"
+#include "Client.hpp"
+#include "Timestamp.hpp"
+#include "TokenBucket.hpp"
+#include "Distribution.hpp"
+#include "SizeMix.hpp"
+
+#ifdef HAVE_SYS_EPOLL_H
+
+/* ------------------------------------------------------------------- */
+class ClientEngine {
+public:
+    // connect the thread's share of the streams
+    ClientEngine( thread_Settings *inSettings );
+
+    // close any streams still open
+    ~ClientEngine();
+
+    // send on all streams until each one finishes
+    void Run( void );
+
+protected:
+    struct Stream {
+        thread_Settings *settings;
+        Client *client;             // NULL once the stream finished
+        TokenBucket *pacer;
+        Distribution *gaps;
+        SizeMix *mix;
+        int pending;                // length of the write the pacer passed
+        bool armed;                 // EPOLLOUT is in the epoll set
+        bool timed;                 // waiting in the timer heap
+        bool closing;               // UDP FIN sent, waiting on EPOLLIN
+        Timestamp retry;            // when to send the FIN again
+    };
+
+    struct Timer {
+        Timestamp due;
+        int stream;
+    };
+
+    // write on a stream until it blocks, must wait or used its budget
+    void Service( int index );
+
+    // turn EPOLLOUT for a stream on or off
+    void Arm( int index, bool on );
+
+    // end a stream's test, a UDP stream's once the server answers
+    // its FIN, and free it
+    void Finish( int index );
+    void Closing( int index, bool readable );
+    void Release( int index );
+
+    // min-heap of the streams waiting for the pacer
+    void TimerPush( Timestamp due, int index );
+    void TimerPop( void );
+
+    enum {
+        kWrite_Budget = 64,         // writes per stream per wakeup
+        kMax_Events   = 256,        // epoll_wait events per call
+        kSweep_Msecs  = 100,        // how often to check blocked streams
+        kFIN_Msecs    = 250         // wait for the ack of a UDP FIN
+    };
+
+    thread_Settings *mSettings;
+    Stream *mStreams;
+    int mCount;
+    int mActive;                    // streams not yet finished
+    Timer *mTimers;
+    int mTimerCount;
+    int mEpoll;
+
+}; // end class ClientEngine
+
+#endif // HAVE_SYS_EPOLL_H
+#endif // CLIENTENGINE_H
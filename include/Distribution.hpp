@@ -0,0 +1,144 @@
+/*--------------------------------------------------------------- 
+ * Copyright (c) 1999,2000,2001,2002,2003                       
+ * The Board of Trustees of the University of Illinois            
+ * All Rights Reserved.                                           
+ *--------------------------------------------------------------- 
+ * Permission is hereby granted, free of charge, to any person    
+ * obtaining a copy of this software (Iperf) and associated       
+ * documentation files (the "Software"), to deal in the Software  
+ * without restriction, including without limitation the          
+ * rights to use, copy, modify, merge, publish, distribute,        
+ * sublicense, and/or sell copies of the Software, and to permit     
+ * persons to whom the Software is furnished to do
+ * so, subject to the following conditions: 
+ *
+ *     
+ * Redistributions of source code must retain the above 
+ * copyright notice, this list of conditions and 
+ * the following disclaimers. 
+ *
+ *     
+ * Redistributions in binary form must reproduce the above 
+ * copyright notice, this list of conditions and the following 
+ * disclaimers in the documentation and/or other materials 
+ * provided with the distribution. 
+ * 
+ *     
+ * Neither the names of the University of Illinois, NCSA, 
+ * nor the names of its contributors may be used to endorse 
+ * or promote products derived from this Software without
+ * specific prior written permission. 
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, 
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES 
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND 
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE CONTIBUTORS OR COPYRIGHT 
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, 
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, 
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE. 
+ * ________________________________________________________________
+ * National Laboratory for Applied Network Research 
+ * National Center for Supercomputing Applications 
+ * University of Illinois at Urbana-Champaign 
+ * http://www.ncsa.uiuc.edu
+ * ________________________________________________________________ 
+ *
+ *
+ * Distribution.hpp
+ * -------------------------------------------------------------------
+ * Inter-departure gap generator for --gap-dist. Each sample scales
+ * one write's share of the -b pacer, and every distribution is
+ * normalized to a mean of one, so the long-term rate is still the
+ * one asked for. The random numbers come from a seeded xorshift64*
+ * generator, which is cheap enough for millions of packets per second
+ * and gives the same sequence for the same seed on every platform.
+ * ------------------------------------------------------------------- */
+
+#ifndef DISTRIBUTION_H
+#define DISTRIBUTION_H
+
+#include "headers.h"
+#include "Settings.hpp"
+
+const double kDefault_ParetoShape = 1.5;
+const double kPareto_Cap = 1000.0;  // largest Pareto gap, in mean gaps
+
+/* ------------------------------------------------------------------- */
+class Distribution {
+public:
+    /* -------------------------------------------------------------------
+     * Create a generator of the given kind. shape is only used by
+     * Pareto, where it must be above one for the mean to exist.
+     * ------------------------------------------------------------------- */
+    Distribution( GapDistribution kind, double shape, u_int32_t seed ) {
+        mKind  = kind;
+        mShape = shape;
+        mXm    = 1.0;
+        mMean  = 1.0;
+
+        // splitmix64 the seed so that small seeds, and zero,
+        // still give a well mixed, non-zero state
+        mState = seed + 0x9E3779B97F4A7C15ULL;
+        mState = (mState ^ (mState >> 30)) * 0xBF58476D1CE4E5B9ULL;
+        mState = (mState ^ (mState >> 27)) * 0x94D049BB133111EBULL;
+        mState ^= mState >> 31;
+        if ( mState == 0 ) {
+            mState = 1;
+        }
+
+        if ( mKind == kGap_Pareto ) {
+            if ( mShape <= 1.0 ) {
+                mShape = kDefault_ParetoShape;
+            }
+            // x_m for a mean of one; samples are capped at kPareto_Cap
+            // so one gap cannot stall the test, and divided by the
+            // mean of the capped distribution to keep the rate exact
+            mXm   = (mShape - 1.0) / mShape;
+            mMean = 1.0 - pow( mXm, mShape ) * pow( kPareto_Cap, 1.0 - mShape ) 
+                          / (mShape - 1.0);
+        }
+    }
+
+    /* -------------------------------------------------------------------
+     * Return the next gap, as a multiple of the mean gap.
+     * ------------------------------------------------------------------- */
+    double next( void ) {
+        double gap;
+
+        switch ( mKind ) {
+            case kGap_Exponential:
+                return -log( uniform() );
+            case kGap_Uniform:
+                return 2.0 * uniform();
+            case kGap_Pareto:
+                gap = mXm / pow( uniform(), 1.0 / mShape );
+                if ( gap > kPareto_Cap ) {
+                    gap = kPareto_Cap;
+                }
+                return gap / mMean;
+            default:
+                return 1.0;
+        }
+    }
+
+    /* -------------------------------------------------------------------
+     * xorshift64*, uniform on (0,1]
+     * ------------------------------------------------------------------- */
+    double uniform( void ) {
+        mState ^= mState >> 12;
+        mState ^= mState << 25;
+        mState ^= mState >> 27;
+        return (((mState * 0x2545F4914F6CDD1DULL) >> 11) + 1) * (1.0 / 9007199254740992.0);
+    }
+
+protected:
+    GapDistribution mKind;
+    double mShape;                  // Pareto alpha
+    double mXm;                     // Pareto x_m
+    double mMean;                   // mean of the capped Pareto samples
+    uint64_t mState;
+
+}; // end class Distribution
+
+#endif // DISTRIBUTION_H
@@ -95,6 +95,23 @@ extern "C" {
      */
     int Extractor_getNextDataBlock( char *block, thread_Settings *mSettings );
 
+    /*
+     * Returns a pointer to the next data
+     * block of a mapped file
+     * @arg len       Length of the block returned
+     * @arg size      Largest block wanted
+     * @return        Pointer into the mapping
+     */
+    char *Extractor_getNextDataPointer( int *len, int size, thread_Settings *mSettings );
+
+    /*
+     * Sends the next data block from 
+     * the file directly to the socket
+     * @arg sock      Socket to send on
+     * @return        Number of bytes sent
+     */
+    int Extractor_sendNextDataBlock( int sock, thread_Settings *mSettings );
+
 
     /**
      * Function which determines whether
@@ -103,6 +120,13 @@ extern "C" {
      */
     int Extractor_canRead( thread_Settings *mSettings );
 
+    /**
+     * Function which determines whether
+     * the file is mapped into memory
+     * @return true, if mapped; false, if not
+     */
+    int Extractor_isMapped( thread_Settings *mSettings );
+
     /**
      * This is used to reduce the read size
      * Used in UDP transfer to accomodate the
@@ -0,0 +1,161 @@
+/*--------------------------------------------------------------- 
+ * Copyright (c) 1999,2000,2001,2002,2003                       
+ * The Board of Trustees of the University of Illinois            
+ * All Rights Reserved.                                           
+ *--------------------------------------------------------------- 
+ * Permission is hereby granted, free of charge, to any person    
+ * obtaining a copy of this software (Iperf) and associated       
+ * documentation files (the "Software"), to deal in the Software  
+ * without restriction, including without limitation the          
+ * rights to use, copy, modify, merge, publish, distribute,        
+ * sublicense, and/or sell copies of the Software, and to permit     
+ * persons to whom the Software is furnished to do
+ * so, subject to the following conditions: 
+ *
+ *     
+ * Redistributions of source code must retain the above 
+ * copyright notice, this list of conditions and 
+ * the following disclaimers. 
+ *
+ *     
+ * Redistributions in binary form must reproduce the above 
+ * copyright notice, this list of conditions and the following 
+ * disclaimers in the documentation and/or other materials 
+ * provided with the distribution. 
+ * 
+ *     
+ * Neither the names of the University of Illinois, NCSA, 
+ * nor the names of its contributors may be used to endorse 
+ * or promote products derived from this Software without
+ * specific prior written permission. 
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, 
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES 
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND 
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE CONTIBUTORS OR COPYRIGHT 
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, 
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, 
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE. 
+ * ________________________________________________________________
+ * National Laboratory for Applied Network Research 
+ * National Center for Supercomputing Applications 
+ * University of Illinois at Urbana-Champaign 
+ * http://www.ncsa.uiuc.edu
+ * ________________________________________________________________ 
+ * IOUring.h
+ * -------------------------------------------------------------------
+ * A small io_uring wrapper for --io-uring, on the raw system calls
+ * so no liburing is needed. The client queues its writes in chains,
+ * datagrams from buffers registered with the ring, and submits each
+ * chain with one call; the server keeps one multishot receive armed
+ * that fills buffers the kernel picks from a provided buffer ring.
+ * ------------------------------------------------------------------- */
+
+#ifndef _IOURING_H
+#define _IOURING_H
+
+#include "headers.h"
+
+// multishot receive and provided buffer rings came with Linux 6.0
+#if defined(HAVE_LINUX_IO_URING_H) && defined(HAVE_SYS_MMAN_H) && \
+    defined(__NR_io_uring_setup) && defined(IORING_RECV_MULTISHOT)
+#define HAVE_IO_URING 1
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#ifdef HAVE_IO_URING
+
+    /*
+     * One ring, used by one thread
+     */
+    typedef struct IOUring {
+        int fd;
+        unsigned entries;
+        // submission queue
+        unsigned *sqHead;
+        unsigned *sqTail;
+        unsigned *sqMask;
+        unsigned *sqArray;
+        struct io_uring_sqe *sqes;
+        unsigned sqTailLocal;       // tail including entries not yet published
+        unsigned toSubmit;
+        // completion queue
+        unsigned *cqHead;
+        unsigned *cqTail;
+        unsigned *cqMask;
+        struct io_uring_cqe *cqes;
+        // mappings
+        void *sqRing;
+        size_t sqRingSize;
+        void *cqRing;
+        size_t cqRingSize;
+        size_t sqesSize;
+        // provided buffers for multishot receive
+        struct io_uring_buf_ring *bufRing;
+        size_t bufRingSize;
+        unsigned bufEntries;
+        unsigned short bufTail;
+        int bufSize;
+        char *bufs;
+    } IOUring;
+
+    /**
+     * Constructor
+     * @arg entries   Submission queue size, a power of 2
+     * @return true, if the kernel set up the ring
+     */
+    int IOUring_Initialize( IOUring *ring, unsigned entries );
+
+    /*
+     * Next free submission entry, cleared, or NULL if the queue is full
+     */
+    struct io_uring_sqe* IOUring_getSQE( IOUring *ring );
+
+    /*
+     * Submit the queued entries, and if wait is set block until at
+     * least that many completions are ready
+     * @return entries submitted, or -errno
+     */
+    int IOUring_Submit( IOUring *ring, unsigned wait );
+
+    /*
+     * The oldest completion, or NULL, and marking it consumed
+     */
+    struct io_uring_cqe* IOUring_peekCQE( IOUring *ring );
+    void IOUring_seenCQE( IOUring *ring );
+
+    /*
+     * Register one buffer for IORING_OP_WRITE_FIXED (buf_index 0)
+     * @return true, on success
+     */
+    int IOUring_RegisterBuffer( IOUring *ring, void *base, size_t len );
+
+    /*
+     * Set up a provided buffer ring of entries buffers of size bytes
+     * each, group 0, for receives with IOSQE_BUFFER_SELECT
+     * @return true, on success
+     */
+    int IOUring_SetupBufRing( IOUring *ring, unsigned entries, int size );
+
+    /*
+     * A provided buffer named by a completion, and handing it back
+     */
+    char* IOUring_getBuffer( IOUring *ring, unsigned short bid );
+    void IOUring_putBuffer( IOUring *ring, unsigned short bid );
+
+    /**
+     * Destructor, also cancels requests still in flight
+     */
+    void IOUring_Destroy( IOUring *ring );
+
+#endif // HAVE_IO_URING
+
+#ifdef __cplusplus
+} /* end extern "C" */
+#endif
+
+#endif
@@ -0,0 +1,116 @@
+/*--------------------------------------------------------------- 
+ * Copyright (c) 1999,2000,2001,2002,2003                              
+ * The Board of Trustees of the University of Illinois            
+ * All Rights Reserved.                                           
+ *--------------------------------------------------------------- 
+ * Permission is hereby granted, free of charge, to any person    
+ * obtaining a copy of this software (Iperf) and associated       
+ * documentation files (the "Software"), to deal in the Software  
+ * without restriction, including without limitation the          
+ * rights to use, copy, modify, merge, publish, distribute,        
+ * sublicense, and/or sell copies of the Software, and to permit     
+ * persons to whom the Software is furnished to do
+ * so, subject to the following conditions: 
+ *
+ *     
+ * Redistributions of source code must retain the above 
+ * copyright notice, this list of conditions and 
+ * the following disclaimers. 
+ *
+ *     
+ * Redistributions in binary form must reproduce the above 
+ * copyright notice, this list of conditions and the following 
+ * disclaimers in the documentation and/or other materials 
+ * provided with the distribution. 
+ * 
+ *     
+ * Neither the names of the University of Illinois, NCSA, 
+ * nor the names of its contributors may be used to endorse 
+ * or promote products derived from this Software without
+ * specific prior written permission. 
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, 
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES 
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND 
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE CONTIBUTORS OR COPYRIGHT 
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, 
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, 
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE. 
+ * ________________________________________________________________
+ * National Laboratory for Applied Network Research 
+ * National Center for Supercomputing Applications 
+ * University of Illinois at Urbana-Champaign 
+ * http://www.ncsa.uiuc.edu
+ * ________________________________________________________________ 
+ * KernelStamp.h
+ * -------------------------------------------------------------------
+ * Kernel timestamps of datagrams. With --rx-timestamps the server asks
+ * the kernel (SO_TIMESTAMPNS) to stamp each datagram as it arrives, so
+ * jitter is measured from when the network delivered it rather than
+ * from when the server thread got to read it, and the difference
+ * between the two is reported as the receiver's own queueing delay.
+ * With --tx-timestamps the client asks the kernel (SO_TIMESTAMPING)
+ * to stamp each datagram as it leaves the stack for the device, and
+ * reads the stamps back from the socket error queue, to report how
+ * long its datagrams spent in its own socket layer.
+ *
+ * The kernel stamps on the wall clock while the reports run on
+ * CLOCK_MONOTONIC, so receive stamps are moved onto CLOCK_MONOTONIC by
+ * the offset between the two clocks, read as the datagrams are.
+ * Transmit stamps stay on the wall clock, to compare with the time
+ * the client took just before its write. Only software stamps are
+ * used, NIC stamps run on the device's own clock.
+ * ------------------------------------------------------------------- */
+
+#ifndef _KERNELSTAMP_H
+#define _KERNELSTAMP_H
+
+#include "headers.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+    /**
+     * Have the kernel stamp the datagrams arriving on sock,
+     * returns 0 or -1 with errno set
+     */
+    int KernelStamp_EnableRX( int sock );
+
+    /*
+     * Bytes of control buffer a read needs for its stamp
+     */
+    int KernelStamp_ControlLen( void );
+
+    /*
+     * The wall clock less CLOCK_MONOTONIC, now
+     */
+    void KernelStamp_ClockOffset( struct timespec *offset );
+
+    /*
+     * Nonzero if msg, as returned by recvmsg(), carries a receive
+     * stamp, which is stored in stamp on CLOCK_MONOTONIC
+     */
+    int KernelStamp_RX( struct msghdr *msg, const struct timespec *offset, 
+                        struct timespec *stamp );
+
+    /**
+     * Have the kernel stamp the datagrams sent on sock, numbering
+     * them from 0, returns 0 or -1 with errno set
+     */
+    int KernelStamp_EnableTX( int sock );
+
+    /*
+     * Take the next transmit stamp off the error queue of sock without
+     * waiting, returns 1 with the number of the datagram it stamped in
+     * key and the stamp, on the wall clock, in stamp, or 0 if there is
+     * none left
+     */
+    int KernelStamp_TX( int sock, u_int32_t *key, struct timespec *stamp );
+
+#ifdef __cplusplus
+} /* end extern "C" */
+#endif
+
+#endif
@@ -84,11 +84,40 @@ public:
 
     void UDPSingleServer ();
 
+    // recvfrom() into mBuf and server->peer for UDPSingleServer
+    int RecvFrom( struct timespec *arrived );
+
+    // start and stop the --workers server threads
+    void StartWorkers( void );
+    void StopWorkers( void );
+
+    // with UDP --workers, open a socket and listener thread per shard
+    void StartShards( void );
+    void SteerShards( void );
+
 protected:
     int mClients;
     char* mBuf;
     thread_Settings *mSettings;
     thread_Settings *server;
+    class ServerEngine **mEngines;  // --workers, NULL for thread per client
+    int mEngineCount;
+    int mNextEngine;
+    int mNextCPU;                   // --affinity, next server thread's CPU
+
+    // UDP --workers, the SO_REUSEPORT sockets sharing the port and
+    // the flows this one reads, 0 when a single socket serves UDP
+    int mShardCount;
+    struct Iperf_ListEntry *mFlows;
+
+    // --udp-batch datagrams RecvFrom has yet to hand out
+    char* mBatchBufs;
+    struct mmsghdr* mBatchMsgs;
+    struct iovec* mBatchIov;
+    iperf_sockaddr* mBatchPeers;
+    int mBatchCount;
+    int mBatchNext;
+    struct timespec mBatchTime;
 
 }; // end class Listener
 
@@ -88,6 +88,44 @@ extern const char client_datagram_size[];
 
 extern const char server_datagram_size[];
 
+extern const char server_datagram_batch[];
+
+extern const char server_datagram_gro[];
+
+extern const char server_reuseport[];
+
+extern const char server_rx_stamps[];
+
+extern const char client_tx_stamps[];
+
+extern const char client_datagram_batch[];
+
+extern const char client_datagram_gso[];
+
+extern const char client_rate_limit[];
+
+extern const char client_isochronous[];
+
+extern const char client_size_mix[];
+
+extern const char client_trace[];
+
+extern const char client_gap_dist[];
+
+extern const char* gap_dist_name[];
+
+extern const char client_fq_pacing[];
+
+extern const char thread_affinity[];
+
+extern const char reporter_affinity[];
+
+extern const char buffer_hugepages[];
+
+extern const char* hugepages_name[];
+
+extern const char payload_verify[];
+
 extern const char tcp_window_size[];
 
 extern const char udp_buffer_size[];
@@ -128,6 +166,24 @@ extern const char report_mss[];
 
 extern const char report_datagrams[];
 
+extern const char report_target_rate[];
+
+extern const char report_delays[];
+
+extern const char report_cpu[];
+
+extern const char report_frames[];
+
+extern const char report_rx_stamps[];
+
+extern const char report_tx_stamps[];
+
+extern const char report_verify[];
+
+extern const char report_zerocopy[];
+
+extern const char report_size_class[];
+
 extern const char report_sum_datagrams[];
 
 extern const char server_reporting[];
@@ -164,12 +220,12 @@ extern const char report_interval_small[];
 
 extern const char warn_invalid_server_option[];
 
+extern const char warn_invalid_server_long_option[];
+
 extern const char warn_invalid_client_option[];
 
 extern const char warn_invalid_compatibility_option[];
 
-extern const char warn_implied_udp[];
-
 extern const char warn_implied_compatibility[];
 
 extern const char warn_buffer_too_small[];
@@ -178,6 +234,58 @@ extern const char warn_invalid_single_threaded[];
 
 extern const char warn_invalid_report_style[];
 
+extern const char warn_batch_large[];
+
+extern const char warn_gso_unsupported[];
+
+extern const char warn_gro_unsupported[];
+
+extern const char warn_rxstamps_unsupported[];
+
+extern const char warn_txstamps_unsupported[];
+
+extern const char warn_zerocopy_unsupported[];
+
+extern const char warn_sendfile_failed[];
+
+extern const char warn_invalid_isochronous[];
+
+extern const char warn_isochronous_unsupported[];
+
+extern const char warn_trace_unsupported[];
+
+extern const char warn_trace_open[];
+
+extern const char warn_trace_record[];
+
+extern const char warn_trace_len[];
+
+extern const char warn_trace_max[];
+
+extern const char warn_invalid_size_mix[];
+
+extern const char warn_size_mix_len[];
+
+extern const char warn_invalid_gap_dist[];
+
+extern const char warn_workers_options[];
+
+extern const char warn_workers_unsupported[];
+
+extern const char warn_workers_udp[];
+
+extern const char warn_reuseport_cpu[];
+
+extern const char warn_pacing_unsupported[];
+
+extern const char warn_verify_unsupported[];
+
+extern const char warn_iouring_unsupported[];
+
+extern const char warn_invalid_affinity[];
+
+extern const char warn_affinity_failed[];
+
 extern const char warn_invalid_report[];
 
 #ifdef __cplusplus
@@ -63,6 +63,7 @@ struct server_hdr;
 
 #define NUM_REPORT_STRUCTS 700
 #define NUM_MULTI_SLOTS    5
+#define NUM_DELAY_BINS     80       // quarter octaves of usecs, to ~1 sec
 
 #ifdef __cplusplus
 extern "C" {
@@ -75,8 +76,20 @@ extern "C" {
 typedef struct ReportStruct {
     int packetID;
     max_size_t packetLen;
-    struct timeval packetTime;
-    struct timeval sentTime;
+    struct timespec packetTime;     // CLOCK_MONOTONIC, sent or received
+    struct timeval sentTime;        // sender's wall clock, from the datagram
+    // --isochronous, taken from the isoch_hdr
+    int frameID;                    // 0 if the datagram is not in a frame
+    int frameBurst;                 // datagrams in the frame
+    struct timeval frameTime;       // sender's wall clock at the frame start
+    struct timeval recvTime;        // receiver's wall clock, for frame latency
+    // --verify, blocks checked since the last packet reported
+    int verified;
+    int corrupt;
+    // --rx-timestamps, secs from the kernel's stamp to the read, or -1
+    double appDelay;
+    // --tx-timestamps, secs from the write to the kernel's stamp, or -1
+    double txDelay;
 } ReportStruct;
 
 /*
@@ -93,9 +106,36 @@ typedef struct Transfer_Info {
     void *reserved_delay;
     int transferID;
     int groupID;
+    int free;                       // streams summed so far, not a char
+                                    // so --workers can sum past 127
     int cntError;
     int cntOutofOrder;
     int cntDatagrams;
+    int cntZeroCopy;                // --zerocopy sends not copied
+    int cntCopied;                  // --zerocopy sends the kernel copied
+    max_size_t mTargetRate;         // -b, paced rate in bits/sec
+    int cntDelays;                  // -b pacing delays taken
+    double delayLate;               // usecs woken past the deadlines
+    double delayLateMax;
+    double cpuTime;                 // sender thread CPU seconds
+    int cntFrames;                  // --isochronous frames received whole
+    int cntFramesLost;              // frames missing a datagram
+    double frameLatency;            // mean frame completion latency, secs
+    double frameLatencyMax;
+    int cntVerified;                // --verify blocks that checked out
+    int cntCorrupt;                 // and those that did not
+    int cntStamped;                 // --rx-timestamps datagrams stamped
+    double appDelay;                // mean secs from stamp to read
+    double appDelayMax;
+    int cntTxStamped;               // --tx-timestamps datagrams stamped
+    double txDelay;                 // mean secs from write to stamp
+    double txDelayP50;
+    double txDelayP99;
+    double txDelayMax;
+    int cntSizeClasses;             // --size-mix sizes
+    int sizeClass[MAX_SIZE_CLASSES];
+    int cntSizeWrites[MAX_SIZE_CLASSES];
+    max_size_t sizeBytes[MAX_SIZE_CLASSES];
     // Hopefully int64_t's
     max_size_t TotalLen;
 #ifdef USE_FIXPT
@@ -109,7 +149,6 @@ typedef struct Transfer_Info {
     char   mFormat;                 // -f
     u_char mTTL;                    // -T
     char   mUDP;
-    char   free;
 } Transfer_Info;
 
 typedef struct Connection_Info {
@@ -122,6 +161,7 @@ typedef struct Connection_Info {
 typedef struct ReporterData {
     char*  mHost;                   // -c
     char*  mLocalhost;              // -B
+    char*  mTraceName;              // --trace
     // int's
     int type;
     int cntError;
@@ -134,6 +174,60 @@ typedef struct ReporterData {
     int mBufLen;                    // -l
     int mMSS;                       // -M
     int mTCPWin;                    // -w
+    int mBatchSize;                 // --udp-batch
+    max_size_t mUDPRate;            // -b
+    max_size_t mFQPacingRate;       // --fq-rate
+    double mFPS;                    // --isochronous
+    int mFrameBurst;
+    int mGapDist;                   // --gap-dist
+    u_int32_t mSeed;                // --seed
+    int mSizeCount;                 // --size-mix
+    int *mCPUs;                     // --affinity
+    int mCPUCount;
+    int *mReporterCPUs;             // --reporter-affinity
+    int mReporterCPUCount;
+    int mHugePages;                 // --hugepages
+    int mVerify;                    // --verify
+    int mUDPGRO;                    // --udp-gro
+    int mRxStamps;                  // --rx-timestamps
+    int mTxStamps;                  // --tx-timestamps
+    int mWorkers;                   // --workers
+    int mReusePortCPU;              // --reuseport-cpu
+    int mSizes[MAX_SIZE_CLASSES];
+    int mSizeWeights[MAX_SIZE_CLASSES];
+    // --isochronous frame tracking on the server
+    int frameID;                    // frame being received
+    int frameBurst;
+    int frameCount;                 // its datagrams seen so far
+    int cntFrames;
+    int lastFrames;
+    int cntFramesLost;
+    int lastFramesLost;
+    double frameLatency;            // summed over whole frames
+    double lastFrameLatency;
+    double frameLatencyMax;         // over the whole test
+    double intervalLatencyMax;      // since the last interval report
+    // --verify counts on the server
+    int cntVerified;
+    int lastVerified;
+    int cntCorrupt;
+    int lastCorrupt;
+    // --rx-timestamps receiver queueing on the server
+    int cntStamped;
+    int lastStamped;
+    double appDelay;                // summed over stamped datagrams
+    double lastAppDelay;
+    double appDelayMax;             // over the whole test
+    double intervalAppDelayMax;     // since the last interval report
+    // --tx-timestamps send stack latency on the client
+    int cntTxStamped;
+    int lastTxStamped;
+    double txDelay;                 // summed over stamped datagrams
+    double lastTxDelay;
+    double txDelayMax;              // over the whole test
+    double intervalTxDelayMax;      // since the last interval report
+    int txDelayBins[NUM_DELAY_BINS];
+    int intervalTxDelayBins[NUM_DELAY_BINS];
     /*   flags is a BitMask of old bools
         bool   mBufLenSet;              // -l
         bool   mCompat;                 // -C
@@ -165,10 +259,10 @@ typedef struct ReporterData {
     // structs or miscellaneous
     Transfer_Info info;
     Connection_Info connection;
-    struct timeval startTime;
-    struct timeval packetTime;
-    struct timeval nextTime;
-    struct timeval intervalTime;
+    struct timespec startTime;
+    struct timespec packetTime;
+    struct timespec nextTime;
+    struct timespec intervalTime;
 } ReporterData;
 
 typedef struct MultiHeader {
@@ -179,7 +273,7 @@ typedef struct MultiHeader {
     ReporterData *report;
     Transfer_Info *data;
     Condition barrier;
-    struct timeval startTime;
+    struct timespec startTime;
 } MultiHeader;
 
 typedef struct ReportHeader {
@@ -197,8 +291,10 @@ typedef void (* report_statistics)( Transfer_Info* );
 typedef void (* report_serverstatistics)( Connection_Info*, Transfer_Info* );
 
 MultiHeader* InitMulti( struct thread_Settings *agent, int inID );
+void BarrierStreams( MultiHeader *multihdr, int streams );
 ReportHeader* InitReport( struct thread_Settings *agent );
 void ReportPacket( ReportHeader *agent, ReportStruct *packet );
+void ReportPacketBatch( ReportHeader *agent, ReportStruct *packets, int count );
 void CloseReport( ReportHeader *agent, ReportStruct *packet );
 void EndReport( ReportHeader *agent );
 Transfer_Info* GetReport( ReportHeader *agent );
@@ -219,14 +315,16 @@ extern report_statistics multiple_reports[];
 extern char buffer[64]; // Buffer for printing
 
 #define rMillion 1000000
+#define rBillion 1000000000
 
+/* timespec arithmetic, on the CLOCK_MONOTONIC report times */
 #define TimeDifference( left, right ) (left.tv_sec  - right.tv_sec) +   \
-        (left.tv_usec - right.tv_usec) / ((double) rMillion)
+        (left.tv_nsec - right.tv_nsec) / ((double) rBillion)
 
 #define TimeAdd( left, right )  do {                                    \
-                                    left.tv_usec += right.tv_usec;      \
-                                    if ( left.tv_usec > rMillion ) {    \
-                                        left.tv_usec -= rMillion;       \
+                                    left.tv_nsec += right.tv_nsec;      \
+                                    if ( left.tv_nsec >= rBillion ) {   \
+                                        left.tv_nsec -= rBillion;       \
                                         left.tv_sec++;                  \
                                     }                                   \
                                     left.tv_sec += right.tv_sec;        \
@@ -71,15 +71,40 @@ public:
     // accepts connection and receives data
     void Run( void );
 
+    // account for one read, false once the transfer is over
+    bool ReadPacket( char *buf, long currLen, ReportStruct *reportstruct, 
+                     max_size_t *totLen );
+
+    // ReadPacket without the ReportPacket
+    bool ParsePacket( char *buf, long currLen, ReportStruct *reportstruct, 
+                      max_size_t *totLen );
+
+    // version of Run's loop that receives through an io_uring
+    bool RunURing( ReportStruct *reportstruct, max_size_t *totLen );
+
+    // UDP version of Run's loop that receives datagrams in batches
+    bool RunBatch( ReportStruct *reportstruct, max_size_t *totLen );
+
     void write_UDP_AckFIN( );
 
     static void Sig_Int( int inSigno );
 
+    // one TCP connection of a --workers thread, which calls
+    // StreamRead whenever the socket is readable
+    void StreamStart( void );
+    long StreamRead( void );
+    void StreamEnd( void );
+
 private:
     thread_Settings *mSettings;
     char* mBuf;
     Timestamp mEndTime;
 
+    ReportStruct *mStreamReport;    // --workers connection state
+    max_size_t mStreamTotal;
+
+    struct Verify_Stream *mVerify;  // --verify state
+
 }; // end class Server
 
 #endif // SERVER_H
@@ -0,0 +1,116 @@
+/*--------------------------------------------------------------- 
+ * Copyright (c) 1999,2000,2001,2002,2003                       
+ * The Board of Trustees of the University of Illinois            
+ * All Rights Reserved.                                           
+ *--------------------------------------------------------------- 
+ * Permission is hereby granted, free of charge, to any person    
+ * obtaining a copy of this software (Iperf) and associated       
+ * documentation files (the "Software"), to deal in the Software  
+ * without restriction, including without limitation the          
+ * rights to use, copy, modify, merge, publish, distribute,        
+ * sublicense, and/or sell copies of the Software, and to permit     
+ * persons to whom the Software is furnished to do
+ * so, subject to the following conditions: 
+ *
+ *     
+ * Redistributions of source code must retain the above 
+ * copyright notice, this list of conditions and 
+ * the following disclaimers. 
+ *
+ *     
+ * Redistributions in binary form must reproduce the above 
+ * copyright notice, this list of conditions and the following 
+ * disclaimers in the documentation and/or other materials 
+ * provided with the distribution. 
+ * 
+ *     
+ * Neither the names of the University of Illinois, NCSA, 
+ * nor the names of its contributors may be used to endorse 
+ * or promote products derived from this Software without
+ * specific prior written permission. 
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, 
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES 
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND 
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE CONTIBUTORS OR COPYRIGHT 
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, 
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, 
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE. 
+ * ________________________________________________________________
+ * National Laboratory for Applied Network Research 
+ * National Center for Supercomputing Applications 
+ * University of Illinois at Urbana-Champaign 
+ * http://www.ncsa.uiuc.edu
+ * ________________________________________________________________ 
+ *
+ * ServerEngine.hpp
+ * -------------------------------------------------------------------
+ * Event driven server for --workers. Instead of a thread per TCP
+ * connection, the Listener hands each accepted connection to one of
+ * a pool of worker threads, round robin. Each worker keeps its
+ * connections non-blocking in one epoll set and reads whichever are
+ * readable, so many clients need only a thread per core.
+ * ------------------------------------------------------------------- */
+
+#ifndef SERVERENGINE_H
+#define SERVERENGINE_H
+
+#include "headers.h"
+#include "Settings.hpp"
+#include "Server.hpp"
+#include "Mutex.h"
+
+#ifdef HAVE_SYS_EPOLL_H
+
+/* ------------------------------------------------------------------- */
+class ServerEngine {
+public:
+    // an empty worker, run by a kMode_Worker thread
+    ServerEngine( thread_Settings *inSettings );
+
+    ~ServerEngine();
+
+    // serve connections until Shutdown and the last one ends
+    void Run( void );
+
+    // called by the Listener, hand over an accepted connection
+    void Add( thread_Settings *server );
+
+    // called by the Listener once it accepts no more connections
+    void Shutdown( void );
+
+protected:
+    struct Connection {
+        thread_Settings *settings;
+        Server *server;
+        Connection *next;           // in the queue from the Listener
+    };
+
+    // read a connection until it blocks or used its budget
+    void Service( Connection *conn );
+
+    // end a connection's test and free it
+    void Finish( Connection *conn );
+
+    // take the connections queued by Add
+    void Drain( void );
+
+    enum {
+        kRead_Budget  = 16,         // reads per connection per wakeup
+        kMax_Events   = 256,        // epoll_wait events per call
+        kWait_Msecs   = 100         // how often to check for Ctrl-C
+    };
+
+    thread_Settings *mSettings;
+    int mEpoll;
+    int mWakeup[2];                 // pipe the Listener writes to on Add
+    Mutex mLock;                    // guards mQueue and mShutdown
+    Connection *mQueue;
+    bool mShutdown;
+    int mActive;                    // connections being served
+
+}; // end class ServerEngine
+
+#endif // HAVE_SYS_EPOLL_H
+#endif // SERVERENGINE_H
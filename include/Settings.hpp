@@ -75,7 +75,8 @@ typedef enum ThreadMode {
     kMode_Server,
     kMode_Client,
     kMode_Reporter,
-    kMode_Listener
+    kMode_Listener,
+    kMode_Worker                    // --workers server thread
 } ThreadMode;
 
 // report mode
@@ -94,6 +95,17 @@ typedef enum TestMode {
     kTest_Unknown
 } TestMode;
 
+// --gap-dist, inter-departure gap distribution
+typedef enum GapDistribution {
+    kGap_Constant = 0,
+    kGap_Exponential,
+    kGap_Uniform,
+    kGap_Pareto
+} GapDistribution;
+
+// --size-mix, most write sizes in a mix
+#define MAX_SIZE_CLASSES 8
+
 #include "Reporter.h"
 /*
  * The thread_Settings is a structure that holds all
@@ -112,11 +124,17 @@ typedef struct thread_Settings {
     char*  mHost;                   // -c
     char*  mLocalhost;              // -B
     char*  mOutputFileName;         // -o
+    char*  mTraceName;              // --trace
     FILE*  Extractor_file;
+    char*  Extractor_map;           // -F file mapped into memory
+    struct Trace_File* mTrace;      // --trace file being replayed
     ReportHeader*  reporthdr;
     MultiHeader*   multihdr;
     struct thread_Settings *runNow;
     struct thread_Settings *runNext;
+    void*  mEngine;                 // ServerEngine of a kMode_Worker thread
+    int*   mCPUs;                   // --affinity, shared by all copies
+    int*   mReporterCPUs;           // --reporter-affinity, likewise
     // int's
     int mThreads;                   // -P
     int mTOS;                       // -S
@@ -125,6 +143,26 @@ typedef struct thread_Settings {
     int mBufLen;                    // -l
     int mMSS;                       // -M
     int mTCPWin;                    // -w
+    int mBatchSize;                 // --udp-batch
+    int mBurstSize;                 // --burst-size
+    int mDelaySpin;                 // --delay-spin
+    int mFrameBurst;                // --isochronous, datagrams per frame
+    int mWorkers;                   // --workers
+    int mWorkerStreams;             // streams this --workers thread drives
+    int mCPUCount;                  // --affinity
+    int mReporterCPUCount;          // --reporter-affinity
+    int mCPU;                       // CPU this thread is pinned to, or -1
+    int mHugePages;                 // --hugepages
+    int mVerify;                    // --verify
+    int mUDPGRO;                    // --udp-gro
+    int mRxStamps;                  // --rx-timestamps
+    int mTxStamps;                  // --tx-timestamps
+    int mReusePortCPU;              // --reuseport-cpu
+    int mShard;                     // UDP --workers socket read, 0 the first
+    u_int32_t mSeed;                // --seed
+    int mSizeCount;                 // --size-mix, sizes in the mix
+    int mSizes[MAX_SIZE_CLASSES];
+    int mSizeWeights[MAX_SIZE_CLASSES];
     /*   flags is a BitMask of old bools
         bool   mBufLenSet;              // -l
         bool   mCompat;                 // -C
@@ -152,11 +190,17 @@ typedef struct thread_Settings {
     ThreadMode mThreadMode;         // -s or -c
     ReportMode mReportMode;
     TestMode mMode;                 // -r or -d
+    GapDistribution mGapDist;       // --gap-dist
     // Hopefully int64_t's
-    max_size_t mUDPRate;            // -b or -u
+    max_size_t mUDPRate;            // -b or -u, bits/sec per stream
     max_size_t mAmount;             // -n or -t
+    max_size_t mFQPacingRate;       // --fq-rate
+    max_size_t Extractor_offset;    // next byte of the -F file
+    max_size_t Extractor_mapsize;
     // doubles
     double mInterval;               // -i
+    double mFPS;                    // --isochronous, frames per second
+    double mGapShape;               // --gap-dist, Pareto shape
     // shorts
     unsigned short mListenPort;     // -L
     unsigned short mPort;           // -p
@@ -210,6 +254,14 @@ typedef struct thread_Settings {
 #define FLAG_SINGLECLIENT   0x00100000
 #define FLAG_SINGLEUDP      0x00200000
 #define FLAG_CONGESTION     0x00400000
+#define FLAG_UDPGSO         0x00800000
+#define FLAG_ZEROCOPY       0x01000000
+#define FLAG_FILELOOP       0x02000000
+#define FLAG_SENDFILE       0x04000000
+#define FLAG_ISOCHRONOUS    0x08000000
+#define FLAG_TRACE          0x10000000
+#define FLAG_WORKER         0x20000000
+#define FLAG_IOURING        0x40000000
 
 #define isBuflenSet(settings)      ((settings->flags & FLAG_BUFLENSET) != 0)
 #define isCompat(settings)         ((settings->flags & FLAG_COMPAT) != 0)
@@ -236,6 +288,14 @@ typedef struct thread_Settings {
 #define isSingleClient(settings)   ((settings->flags & FLAG_SINGLECLIENT) != 0)
 #define isSingleUDP(settings)      ((settings->flags & FLAG_SINGLEUDP) != 0)
 #define isCongestionControl(settings) ((settings->flags & FLAG_CONGESTION) != 0)
+#define isUDPGSO(settings)         ((settings->flags & FLAG_UDPGSO) != 0)
+#define isZeroCopy(settings)       ((settings->flags & FLAG_ZEROCOPY) != 0)
+#define isFileLoop(settings)       ((settings->flags & FLAG_FILELOOP) != 0)
+#define isSendFile(settings)       ((settings->flags & FLAG_SENDFILE) != 0)
+#define isIsochronous(settings)    ((settings->flags & FLAG_ISOCHRONOUS) != 0)
+#define isTrace(settings)          ((settings->flags & FLAG_TRACE) != 0)
+#define isWorker(settings)         ((settings->flags & FLAG_WORKER) != 0)
+#define isIOUring(settings)        ((settings->flags & FLAG_IOURING) != 0)
 
 #define setBuflenSet(settings)     settings->flags |= FLAG_BUFLENSET
 #define setCompat(settings)        settings->flags |= FLAG_COMPAT
@@ -260,6 +320,14 @@ typedef struct thread_Settings {
 #define setSingleClient(settings)  settings->flags |= FLAG_SINGLECLIENT
 #define setSingleUDP(settings)     settings->flags |= FLAG_SINGLEUDP
 #define setCongestionControl(settings) settings->flags |= FLAG_CONGESTION
+#define setUDPGSO(settings)        settings->flags |= FLAG_UDPGSO
+#define setZeroCopy(settings)      settings->flags |= FLAG_ZEROCOPY
+#define setFileLoop(settings)      settings->flags |= FLAG_FILELOOP
+#define setSendFile(settings)      settings->flags |= FLAG_SENDFILE
+#define setIsochronous(settings)   settings->flags |= FLAG_ISOCHRONOUS
+#define setTrace(settings)         settings->flags |= FLAG_TRACE
+#define setWorker(settings)        settings->flags |= FLAG_WORKER
+#define setIOUring(settings)       settings->flags |= FLAG_IOURING
 
 #define unsetBuflenSet(settings)   settings->flags &= ~FLAG_BUFLENSET
 #define unsetCompat(settings)      settings->flags &= ~FLAG_COMPAT
@@ -284,9 +352,18 @@ typedef struct thread_Settings {
 #define unsetSingleClient(settings)   settings->flags &= ~FLAG_SINGLECLIENT
 #define unsetSingleUDP(settings)      settings->flags &= ~FLAG_SINGLEUDP
 #define unsetCongestionControl(settings) settings->flags &= ~FLAG_CONGESTION
+#define unsetUDPGSO(settings)      settings->flags &= ~FLAG_UDPGSO
+#define unsetZeroCopy(settings)    settings->flags &= ~FLAG_ZEROCOPY
+#define unsetFileLoop(settings)    settings->flags &= ~FLAG_FILELOOP
+#define unsetSendFile(settings)    settings->flags &= ~FLAG_SENDFILE
+#define unsetIsochronous(settings) settings->flags &= ~FLAG_ISOCHRONOUS
+#define unsetTrace(settings)       settings->flags &= ~FLAG_TRACE
+#define unsetWorker(settings)      settings->flags &= ~FLAG_WORKER
+#define unsetIOUring(settings)     settings->flags &= ~FLAG_IOURING
 
 
 #define HEADER_VERSION1 0x80000000
+#define HEADER_ISOCH    0x40000000
 #define RUN_NOW         0x00000001
 
 // used to reference the 4 byte ID number we place in UDP datagrams
@@ -342,6 +419,25 @@ typedef struct client_hdr {
 #endif
 } client_hdr;
 
+/*
+ * The isoch_hdr follows the client_hdr in every datagram of an
+ * --isochronous test, which sets HEADER_ISOCH in the client_hdr
+ * flags, so the server can put the datagrams back into frames.
+ */
+typedef struct isoch_hdr {
+#ifdef HAVE_INT32_T
+    int32_t frameid;
+    int32_t burstsize;
+    u_int32_t start_tv_sec;
+    u_int32_t start_tv_usec;
+#else
+    signed int frameid         : 32;
+    signed int burstsize       : 32;
+    unsigned int start_tv_sec  : 32;
+    unsigned int start_tv_usec : 32;
+#endif
+} isoch_hdr;
+
 /*
  * The server_hdr structure facilitates the server
  * report of jitter and loss on the client side.
@@ -407,6 +503,12 @@ typedef struct server_hdr {
     // convert to upper case for [KMG]bytes/sec
     void Settings_GetUpperCaseArg(const char *,char *);
 
+    // parse a --size-mix list of sizes and weights
+    void Settings_ParseSizeMix( thread_Settings *mSettings, const char *mix );
+
+    // parse an --affinity or --reporter-affinity CPU list
+    void Settings_ParseAffinity( const char *list, int **cpus, int *count );
+
     // generate settings for listener instance
     void Settings_GenerateListenerSettings( thread_Settings *client, thread_Settings **listener);
 
@@ -0,0 +1,149 @@
+/*--------------------------------------------------------------- 
+ * Copyright (c) 1999,2000,2001,2002,2003                       
+ * The Board of Trustees of the University of Illinois            
+ * All Rights Reserved.                                           
+ *--------------------------------------------------------------- 
+ * Permission is hereby granted, free of charge, to any person    
+ * obtaining a copy of this software (Iperf) and associated       
+ * documentation files (the "Software"), to deal in the Software  
+ * without restriction, including without limitation the          
+ * rights to use, copy, modify, merge, publish, distribute,        
+ * sublicense, and/or sell copies of the Software, and to permit     
+ * persons to whom the Software is furnished to do
+ * so, subject to the following conditions: 
+ *
+ *     
+ * Redistributions of source code must retain the above 
+ * copyright notice, this list of conditions and 
+ * the following disclaimers. 
+ *
+ *     
+ * Redistributions in binary form must reproduce the above 
+ * copyright notice, this list of conditions and the following 
+ * disclaimers in the documentation and/or other materials 
+ * provided with the distribution. 
+ * 
+ *     
+ * Neither the names of the University of Illinois, NCSA, 
+ * nor the names of its contributors may be used to endorse 
+ * or promote products derived from this Software without
+ * specific prior written permission. 
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, 
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES 
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND 
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE CONTIBUTORS OR COPYRIGHT 
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, 
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, 
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE. 
+ * ________________________________________________________________
+ * National Laboratory for Applied Network Research 
+ * National Center for Supercomputing Applications 
+ * University of Illinois at Urbana-Champaign 
+ * http://www.ncsa.uiuc.edu
+ * ________________________________________________________________ 
+ * SizeMix.hpp
+ * -------------------------------------------------------------------
+ * Write size generator for --size-mix. Each write or datagram takes
+ * its size from a weighted mix of sizes, such as IMIX, instead of
+ * always using -l, and the bytes and writes of each size are counted
+ * for the final report. The sizes are drawn with the same seeded
+ * generator as --gap-dist so a run can be repeated with --seed.
+ * ------------------------------------------------------------------- */
+
+#ifndef SIZEMIX_H
+#define SIZEMIX_H
+
+#include "headers.h"
+#include "Settings.hpp"
+#include "SocketAddr.h"
+#include "Distribution.hpp"
+
+/* ------------------------------------------------------------------- */
+class SizeMix {
+public:
+    /* -------------------------------------------------------------------
+     * Take the mix from the settings. Sizes below minLen, the headers
+     * a datagram must carry, are raised to it.
+     * ------------------------------------------------------------------- */
+    SizeMix( thread_Settings *inSettings, int minLen )
+        : mRandom( kGap_Constant, 0, inSettings->mSeed ^ 0x53495A45 ) {
+        mCount = inSettings->mSizeCount;
+        mTotal = 0;
+        mLast  = 0;
+        for ( int i = 0; i < mCount; i++ ) {
+            int size = inSettings->mSizes[i] - overhead( inSettings );
+            mSizes[i] = ( size < minLen ? minLen : size );
+            mTotal += inSettings->mSizeWeights[i];
+            mLimit[i] = mTotal;
+            mWrites[i] = 0;
+            mBytes[i] = 0;
+        }
+    }
+
+    /* -------------------------------------------------------------------
+     * For UDP the sizes are Ethernet frame lengths, as IMIX gives them,
+     * so each datagram leaves room for the Ethernet header and FCS and
+     * the IP and UDP headers, as --trace does for the IP packet length.
+     * TCP writes are a byte stream and keep the sizes as given.
+     * ------------------------------------------------------------------- */
+    static int overhead( thread_Settings *inSettings ) {
+        if ( !isUDP( inSettings ) ) {
+            return 0;
+        }
+        return ( SockAddr_isIPv6( &inSettings->peer ) ? 18 + 40 + 8 : 18 + 20 + 8 );
+    }
+
+    // is there a mix, or does every write use -l
+    bool active( void ) {
+        return mCount > 0;
+    }
+
+    /* -------------------------------------------------------------------
+     * Return the size of the next write.
+     * ------------------------------------------------------------------- */
+    int next( void ) {
+        double pick = mRandom.uniform() * mTotal;
+
+        for ( mLast = 0; mLast < mCount - 1; mLast++ ) {
+            if ( pick <= mLimit[mLast] ) {
+                break;
+            }
+        }
+        return mSizes[mLast];
+    }
+
+    // count the bytes the last write sent
+    void sent( long len ) {
+        if ( mCount > 0 && len >= 0 ) {
+            mWrites[mLast]++;
+            mBytes[mLast] += len;
+        }
+    }
+
+    /* -------------------------------------------------------------------
+     * Hand the per size counts to the final report.
+     * ------------------------------------------------------------------- */
+    void report( Transfer_Info *info ) {
+        info->cntSizeClasses = mCount;
+        for ( int i = 0; i < mCount; i++ ) {
+            info->sizeClass[i] = mSizes[i];
+            info->cntSizeWrites[i] = mWrites[i];
+            info->sizeBytes[i] = mBytes[i];
+        }
+    }
+
+protected:
+    Distribution mRandom;
+    int mCount;
+    int mTotal;                     // sum of the weights
+    int mLast;                      // class of the last write
+    int mSizes[MAX_SIZE_CLASSES];
+    int mLimit[MAX_SIZE_CLASSES];   // running sum of the weights
+    int mWrites[MAX_SIZE_CLASSES];
+    max_size_t mBytes[MAX_SIZE_CLASSES];
+
+}; // end class SizeMix
+
+#endif // SIZEMIX_H
@@ -149,6 +149,7 @@ typedef int nthread_t;
     void client_spawn( struct thread_Settings* thread );
     void client_init( struct thread_Settings* clients );
     void listener_spawn( struct thread_Settings* thread );
+    void worker_spawn( struct thread_Settings* thread );
 
     // defined in reporter.c
     void reporter_spawn( struct thread_Settings* thread );
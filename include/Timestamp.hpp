@@ -48,7 +48,10 @@
  * by Mark Gates <mgates@nlanr.net>
  * -------------------------------------------------------------------
  * A generic interface to a timestamp.
- * This implementation uses the unix gettimeofday().
+ * This implementation uses CLOCK_MONOTONIC with nanosecond
+ * resolution (see gettime_monotonic), so it measures durations and
+ * not wall clock time. Use gettimeofday() for the on-wire sender
+ * timestamps.
  * -------------------------------------------------------------------
  * headers
  * uses
@@ -90,7 +93,7 @@ public:
      * Set timestamp to current time.
      * ------------------------------------------------------------------- */
     void setnow( void ) {
-        gettimeofday( &mTime, NULL );
+        gettime_monotonic( &mTime );
     }
 
     /* -------------------------------------------------------------------
@@ -101,7 +104,7 @@ public:
         assert( usec >= 0  &&  usec < kMillion );
 
         mTime.tv_sec  = sec;
-        mTime.tv_usec = usec;      
+        mTime.tv_nsec = usec * kThousand;
     }
 
     /* -------------------------------------------------------------------
@@ -109,7 +112,7 @@ public:
      * ------------------------------------------------------------------- */
     void set( double sec ) {
         mTime.tv_sec  = (long) sec;
-        mTime.tv_usec = (long) ((sec - mTime.tv_sec) * kMillion);
+        mTime.tv_nsec = (long) ((sec - mTime.tv_sec) * kBillion);
     }
 
     /* -------------------------------------------------------------------
@@ -123,14 +126,21 @@ public:
      * return microseconds portion of timestamp
      * ------------------------------------------------------------------- */
     long getUsecs( void ) {
-        return mTime.tv_usec;
+        return mTime.tv_nsec / kThousand;
+    }
+
+    /* -------------------------------------------------------------------
+     * return nanoseconds portion of timestamp
+     * ------------------------------------------------------------------- */
+    long getNsecs( void ) {
+        return mTime.tv_nsec;
     }
 
     /* -------------------------------------------------------------------
      * return timestamp as a floating point seconds
      * ------------------------------------------------------------------- */
     double get( void ) {
-        return mTime.tv_sec + mTime.tv_usec / ((double) kMillion);
+        return mTime.tv_sec + mTime.tv_nsec / ((double) kBillion);
     }
 
     /* -------------------------------------------------------------------
@@ -139,16 +149,16 @@ public:
      * ------------------------------------------------------------------- */
     long subUsec( Timestamp right ) {
         return(mTime.tv_sec  - right.mTime.tv_sec) * kMillion +
-        (mTime.tv_usec - right.mTime.tv_usec);
+        (mTime.tv_nsec - right.mTime.tv_nsec) / kThousand;
     }
 
     /* -------------------------------------------------------------------
      * subtract the right timestamp from my timestamp.
      * return the difference in microseconds.
      * ------------------------------------------------------------------- */
-    long subUsec( timeval right ) {
+    long subUsec( timespec right ) {
         return(mTime.tv_sec  - right.tv_sec) * kMillion +
-        (mTime.tv_usec - right.tv_usec);
+        (mTime.tv_nsec - right.tv_nsec) / kThousand;
     }
 
     /* -------------------------------------------------------------------
@@ -157,7 +167,7 @@ public:
      * ------------------------------------------------------------------- */
     double subSec( Timestamp right ) {
         return(mTime.tv_sec  - right.mTime.tv_sec) +
-        (mTime.tv_usec - right.mTime.tv_usec) / ((double) kMillion);
+        (mTime.tv_nsec - right.mTime.tv_nsec) / ((double) kBillion);
     }
 
     /* -------------------------------------------------------------------
@@ -165,20 +175,20 @@ public:
      * ------------------------------------------------------------------- */
     void add( Timestamp right ) {
         mTime.tv_sec  += right.mTime.tv_sec;
-        mTime.tv_usec += right.mTime.tv_usec;
+        mTime.tv_nsec += right.mTime.tv_nsec;
 
         // watch for under- and overflow
-        if ( mTime.tv_usec < 0 ) {
-            mTime.tv_usec += kMillion;
+        if ( mTime.tv_nsec < 0 ) {
+            mTime.tv_nsec += kBillion;
             mTime.tv_sec--;
         }
-        if ( mTime.tv_usec >= kMillion ) {
-            mTime.tv_usec -= kMillion;
+        if ( mTime.tv_nsec >= kBillion ) {
+            mTime.tv_nsec -= kBillion;
             mTime.tv_sec++;
         }
 
-        assert( mTime.tv_usec >= 0  &&
-                mTime.tv_usec <  kMillion );
+        assert( mTime.tv_nsec >= 0  &&
+                mTime.tv_nsec <  kBillion );
     }
 
     /* -------------------------------------------------------------------
@@ -187,16 +197,16 @@ public:
      * ------------------------------------------------------------------- */
     void add( double sec ) {
         mTime.tv_sec  += (long) sec;
-        mTime.tv_usec += (long) ((sec - ((long) sec )) * kMillion);
+        mTime.tv_nsec += (long) ((sec - ((long) sec )) * kBillion);
 
         // watch for overflow
-        if ( mTime.tv_usec >= kMillion ) {
-            mTime.tv_usec -= kMillion;
+        if ( mTime.tv_nsec >= kBillion ) {
+            mTime.tv_nsec -= kBillion;
             mTime.tv_sec++;
         }
 
-        assert( mTime.tv_usec >= 0  &&
-                mTime.tv_usec <  kMillion );
+        assert( mTime.tv_nsec >= 0  &&
+                mTime.tv_nsec <  kBillion );
     }
 
     /* -------------------------------------------------------------------
@@ -205,16 +215,16 @@ public:
     bool before( Timestamp right ) {
         return mTime.tv_sec < right.mTime.tv_sec  ||
         (mTime.tv_sec == right.mTime.tv_sec &&
-         mTime.tv_usec < right.mTime.tv_usec);
+         mTime.tv_nsec < right.mTime.tv_nsec);
     }
     
     /* -------------------------------------------------------------------
      * return true if my timestamp is before the right timestamp.
      * ------------------------------------------------------------------- */
-    bool before( timeval right ) {
+    bool before( timespec right ) {
         return mTime.tv_sec < right.tv_sec  ||
         (mTime.tv_sec == right.tv_sec &&
-         mTime.tv_usec < right.tv_usec);
+         mTime.tv_nsec < right.tv_nsec);
     }
 
     /* -------------------------------------------------------------------
@@ -223,7 +233,7 @@ public:
     bool after( Timestamp right ) {
         return mTime.tv_sec > right.mTime.tv_sec  ||
         (mTime.tv_sec == right.mTime.tv_sec &&
-         mTime.tv_usec > right.mTime.tv_usec);
+         mTime.tv_nsec > right.mTime.tv_nsec);
     }
 
     /**
@@ -242,10 +252,12 @@ public:
 
 protected:
     enum {
-        kMillion = 1000000
+        kThousand = 1000,
+        kMillion = 1000000,
+        kBillion = 1000000000
     };
 
-    struct timeval mTime;
+    struct timespec mTime;
 
 }; // end class Timestamp
 
@@ -0,0 +1,120 @@
+/*--------------------------------------------------------------- 
+ * Copyright (c) 1999,2000,2001,2002,2003                       
+ * The Board of Trustees of the University of Illinois            
+ * All Rights Reserved.                                           
+ *--------------------------------------------------------------- 
+ * Permission is hereby granted, free of charge, to any person    
+ * obtaining a copy of this software (Iperf) and associated       
+ * documentation files (the "Software"), to deal in the Software  
+ * without restriction, including without limitation the          
+ * rights to use, copy, modify, merge, publish, distribute,        
+ * sublicense, and/or sell copies of the Software, and to permit     
+ * persons to whom the Software is furnished to do
+ * so, subject to the following conditions: 
+ *
+ *     
+ * Redistributions of source code must retain the above 
+ * copyright notice, this list of conditions and 
+ * the following disclaimers. 
+ *
+ *     
+ * Redistributions in binary form must reproduce the above 
+ * copyright notice, this list of conditions and the following 
+ * disclaimers in the documentation and/or other materials 
+ * provided with the distribution. 
+ * 
+ *     
+ * Neither the names of the University of Illinois, NCSA, 
+ * nor the names of its contributors may be used to endorse 
+ * or promote products derived from this Software without
+ * specific prior written permission. 
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, 
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES 
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND 
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE CONTIBUTORS OR COPYRIGHT 
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, 
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, 
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE. 
+ * ________________________________________________________________
+ * National Laboratory for Applied Network Research 
+ * National Center for Supercomputing Applications 
+ * University of Illinois at Urbana-Champaign 
+ * http://www.ncsa.uiuc.edu
+ * ________________________________________________________________ 
+ *
+ * TokenBucket.hpp
+ * -------------------------------------------------------------------
+ * A token bucket rate limiter. Tokens (bytes) accumulate at the
+ * target rate up to the burst size; each write takes its length in
+ * tokens and, when that leaves the bucket in debt, waits until the
+ * debt is repaid. The long-term rate is exact because the debt is
+ * carried forward, while back-to-back sends after an idle period
+ * are bounded by the burst size.
+ * ------------------------------------------------------------------- */
+
+#ifndef TOKENBUCKET_H
+#define TOKENBUCKET_H
+
+#include "headers.h"
+#include "Timestamp.hpp"
+
+/* ------------------------------------------------------------------- */
+class TokenBucket {
+public:
+    /* -------------------------------------------------------------------
+     * Create a full bucket for the given rate in bits per second and
+     * burst size in bytes. A rate of zero means unlimited. A burst of
+     * zero picks kDefault_Burst worth of the rate, but at least one
+     * write, so a sender that is briefly descheduled can catch up.
+     * ------------------------------------------------------------------- */
+    TokenBucket( max_size_t rate, int burst, int write ) {
+        mRate   = rate / (8.0 * kMillion);
+        mBurst  = burst;
+        if ( burst <= 0 ) {
+            mBurst = mRate * kDefault_Burst;
+            if ( mBurst < write ) {
+                mBurst = write;
+            }
+        }
+        mTokens = mBurst;
+    }
+
+    /* -------------------------------------------------------------------
+     * Take len bytes worth of tokens. Return how many microseconds
+     * to wait before the bytes may be sent, zero if they may go now.
+     * len need not be whole, --gap-dist scales it by a random factor.
+     * ------------------------------------------------------------------- */
+    long consume( double len ) {
+        Timestamp now;
+
+        if ( mRate <= 0 ) {
+            return 0;
+        }
+        mTokens += now.subSec( mLast ) * kMillion * mRate;
+        mLast = now;
+        if ( mTokens > mBurst ) {
+            mTokens = mBurst;
+        }
+        mTokens -= len;
+        if ( mTokens >= 0 ) {
+            return 0;
+        }
+        return (long) (-mTokens / mRate);
+    }
+
+protected:
+    enum {
+        kMillion = 1000000,
+        kDefault_Burst = 10000      // microseconds
+    };
+
+    double mRate;                   // bytes per microsecond
+    double mBurst;                  // bytes
+    double mTokens;                 // bytes, negative while in debt
+    Timestamp mLast;                // time of the last refill
+
+}; // end class TokenBucket
+
+#endif // TOKENBUCKET_H
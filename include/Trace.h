@@ -0,0 +1,112 @@
+/*--------------------------------------------------------------- 
+ * Copyright (c) 1999,2000,2001,2002,2003                              
+ * The Board of Trustees of the University of Illinois            
+ * All Rights Reserved.                                           
+ *--------------------------------------------------------------- 
+ * Permission is hereby granted, free of charge, to any person    
+ * obtaining a copy of this software (Iperf) and associated       
+ * documentation files (the "Software"), to deal in the Software  
+ * without restriction, including without limitation the          
+ * rights to use, copy, modify, merge, publish, distribute,        
+ * sublicense, and/or sell copies of the Software, and to permit     
+ * persons to whom the Software is furnished to do
+ * so, subject to the following conditions: 
+ *
+ *     
+ * Redistributions of source code must retain the above 
+ * copyright notice, this list of conditions and 
+ * the following disclaimers. 
+ *
+ *     
+ * Redistributions in binary form must reproduce the above 
+ * copyright notice, this list of conditions and the following 
+ * disclaimers in the documentation and/or other materials 
+ * provided with the distribution. 
+ * 
+ *     
+ * Neither the names of the University of Illinois, NCSA, 
+ * nor the names of its contributors may be used to endorse 
+ * or promote products derived from this Software without
+ * specific prior written permission. 
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, 
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES 
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND 
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE CONTIBUTORS OR COPYRIGHT 
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, 
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, 
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE. 
+ * ________________________________________________________________
+ * National Laboratory for Applied Network Research 
+ * National Center for Supercomputing Applications 
+ * University of Illinois at Urbana-Champaign 
+ * http://www.ncsa.uiuc.edu
+ * ________________________________________________________________ 
+ * Trace.h
+ * -------------------------------------------------------------------
+ * Read a packet trace, a text file of (time offset, size) records or
+ * a pcap capture, for the client to replay with the same packet sizes
+ * and timing. The file is mapped a window at a time so traces larger
+ * than memory are streamed rather than loaded.
+ * ------------------------------------------------------------------- */
+
+#ifndef _TRACE_H
+#define _TRACE_H
+
+#include "headers.h"
+#include "Settings.hpp"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define TRACE_TEXT 0
+#define TRACE_PCAP 1
+
+    /*
+     * State of one open trace, each client
+     * stream reads its own copy of the file
+     */
+    typedef struct Trace_File {
+        FILE *file;
+        int format;                 // TRACE_TEXT or TRACE_PCAP
+        int swap;                   // pcap written in the other byte order
+        int nsec;                   // pcap timestamps in nanoseconds
+        int linktype;               // pcap link layer
+        int overhead;               // IP and UDP header bytes of the replay
+        int records;                // records read so far
+        double first;               // time of the first record
+        max_size_t filesize;
+        max_size_t mapstart;        // file offset of the window
+        max_size_t mapsize;
+        max_size_t pos;             // next byte, from the window start
+        char *map;
+        int mapped;                 // map is an mmap(), not a buffer
+    } Trace_File;
+
+    /**
+     * Constructor
+     * @arg fileName   Name of the trace
+     * @return true, if the trace could be opened
+     */
+    int Trace_Initialize( char *fileName, thread_Settings *mSettings );
+
+    /*
+     * Fetches the next record of the trace
+     * @arg offset    Seconds from the first record
+     * @arg size      UDP payload bytes to send
+     * @return true, if a record was read;
+     *         false, at the end of the trace
+     */
+    int Trace_getNextRecord( double *offset, int *size, thread_Settings *mSettings );
+
+    /**
+     * Destructor
+     */
+    void Trace_Destroy( thread_Settings *mSettings );
+#ifdef __cplusplus
+} /* end extern "C" */
+#endif
+
+#endif
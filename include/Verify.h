@@ -0,0 +1,130 @@
+/*--------------------------------------------------------------- 
+ * Copyright (c) 1999,2000,2001,2002,2003                              
+ * The Board of Trustees of the University of Illinois            
+ * All Rights Reserved.                                           
+ *--------------------------------------------------------------- 
+ * Permission is hereby granted, free of charge, to any person    
+ * obtaining a copy of this software (Iperf) and associated       
+ * documentation files (the "Software"), to deal in the Software  
+ * without restriction, including without limitation the          
+ * rights to use, copy, modify, merge, publish, distribute,        
+ * sublicense, and/or sell copies of the Software, and to permit     
+ * persons to whom the Software is furnished to do
+ * so, subject to the following conditions: 
+ *
+ *     
+ * Redistributions of source code must retain the above 
+ * copyright notice, this list of conditions and 
+ * the following disclaimers. 
+ *
+ *     
+ * Redistributions in binary form must reproduce the above 
+ * copyright notice, this list of conditions and the following 
+ * disclaimers in the documentation and/or other materials 
+ * provided with the distribution. 
+ * 
+ *     
+ * Neither the names of the University of Illinois, NCSA, 
+ * nor the names of its contributors may be used to endorse 
+ * or promote products derived from this Software without
+ * specific prior written permission. 
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, 
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES 
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND 
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE CONTIBUTORS OR COPYRIGHT 
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, 
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, 
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE. 
+ * ________________________________________________________________
+ * National Laboratory for Applied Network Research 
+ * National Center for Supercomputing Applications 
+ * University of Illinois at Urbana-Champaign 
+ * http://www.ncsa.uiuc.edu
+ * ________________________________________________________________ 
+ * Verify.h
+ * -------------------------------------------------------------------
+ * --verify payload checking. The client fills what it sends with
+ * data derived from a sequence number and a CRC32C, the server checks
+ * the CRC32C as the data arrives and counts the blocks that fail.
+ *
+ * A TCP stream is cut into VERIFY_BLOCK byte blocks, whatever the
+ * sizes of the writes and reads, each laid out as
+ *
+ *     8 bytes   block number, network order
+ *     ...       words derived from the block number
+ *     4 bytes   VERIFY_BLOCK, network order
+ *     4 bytes   CRC32C of all of the above, network order
+ *
+ * A UDP datagram is one block: after its headers come words derived
+ * from the datagram ID, and its last 4 bytes are the CRC32C of the
+ * rest of the datagram, headers included. The client_hdr is left
+ * alone even with -C so the server never mistakes the words for one.
+ * ------------------------------------------------------------------- */
+
+#ifndef _VERIFY_H
+#define _VERIFY_H
+
+#include "headers.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define VERIFY_BLOCK 4096
+
+/*
+ * What the server has checked of one connection
+ */
+typedef struct Verify_Stream {
+    max_size_t seq;                 // block number expected next
+    int fill;                       // bytes of it in block so far
+    int verified;                   // blocks whose CRC32C matched
+    int corrupt;                    // and those whose did not
+    char block[ VERIFY_BLOCK ];     // a block split across reads
+} Verify_Stream;
+
+    /**
+     * Picks the CRC32C instructions if the CPU has them
+     */
+    void Verify_Initialize( void );
+
+    /*
+     * Nonzero if the CRC32C is computed by the CPU
+     */
+    int Verify_Hardware( void );
+
+    /*
+     * CRC32C (Castagnoli) of len bytes, continuing from crc,
+     * which is 0 to start
+     */
+    u_int32_t Verify_CRC32C( u_int32_t crc, const void *buf, size_t len );
+
+    /*
+     * Fill buf with len bytes of the TCP stream, starting offset
+     * bytes into it
+     */
+    void Verify_FillStream( char *buf, long len, max_size_t offset );
+
+    /*
+     * Check len more bytes of the TCP stream
+     */
+    void Verify_CheckStream( Verify_Stream *stream, const char *buf, long len );
+
+    /*
+     * Fill the datagram after its hdrLen bytes of headers and set its
+     * CRC32C, the headers must already be in place
+     */
+    void Verify_FillDatagram( char *buf, long len, int hdrLen, u_int32_t id );
+
+    /*
+     * Nonzero if the datagram's CRC32C matches
+     */
+    int Verify_CheckDatagram( const char *buf, long len );
+
+#ifdef __cplusplus
+} /* end extern "C" */
+#endif
+
+#endif
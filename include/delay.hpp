@@ -53,6 +53,24 @@
 #ifndef DELAY_H
 #define DELAY_H
 
+/* -------------------------------------------------------------------
+ * Running totals for one sender, so the pacing accuracy and the cost
+ * of waiting can be reported. spin is how many usecs before each
+ * deadline delay_loop stops sleeping and starts spinning.
+ * ------------------------------------------------------------------- */
+typedef struct delay_stats {
+    long spin;                      // --delay-spin
+    unsigned long count;            // delays taken
+    double late;                    // usecs woken past the deadlines
+    double late_max;                // worst single wake up, usecs
+} delay_stats;
+
+const long kDefault_DelaySpin = 100;
+
 void delay_loop( unsigned long usecs );
 
+void delay_loop_stats( unsigned long usecs, delay_stats *stats );
+
+double delay_cputime( void );
+
 #endif /* DELAY_H */
@@ -67,6 +67,21 @@ int gettimeofday( struct timeval* tv, void* timezone );
     #endif
 
 #endif /* HAVE_GETTIMEOFDAY */
+
+    #ifdef __cplusplus
+extern "C" {
+#endif
+
+/* -------------------------------------------------------------------
+ * Read CLOCK_MONOTONIC, for durations that must not jump when the
+ * wall clock is stepped or slewed. Falls back to gettimeofday.
+ * ------------------------------------------------------------------- */
+void gettime_monotonic( struct timespec* ts );
+
+#ifdef __cplusplus
+} /* end extern "C" */
+    #endif
+
 #endif /* GETTIMEOFDAY_H */
 
 
@@ -172,6 +172,52 @@ SPECIAL_OSF1_EXTERN_C_START
 SPECIAL_OSF1_EXTERN_C_STOP
     #include <netinet/in.h>
     #include <netinet/tcp.h>
+    #include <netinet/udp.h>
+
+    #ifdef HAVE_SYS_MMAN_H
+        #include <sys/stat.h>
+        #include <sys/mman.h>
+    #endif // HAVE_SYS_MMAN_H
+
+    #ifdef HAVE_SYS_EPOLL_H
+        #include <fcntl.h>
+        #include <sys/epoll.h>
+        #include <sys/resource.h>
+    #endif // HAVE_SYS_EPOLL_H
+
+    #ifdef HAVE_LINUX_IO_URING_H
+        #include <linux/io_uring.h>
+        #include <sys/syscall.h>
+        #include <sys/uio.h>
+    #endif // HAVE_LINUX_IO_URING_H
+
+    #ifdef HAVE_SYS_SENDFILE_H
+        #include <sys/sendfile.h>
+    #endif // HAVE_SYS_SENDFILE_H
+
+    #ifdef HAVE_POLL_H
+        #include <poll.h>
+    #endif // HAVE_POLL_H
+
+    #ifdef HAVE_LINUX_ERRQUEUE_H
+        #include <linux/errqueue.h>
+        #if defined(SO_ZEROCOPY) && defined(MSG_ZEROCOPY) && defined(SO_EE_ORIGIN_ZEROCOPY)
+            #define HAVE_MSG_ZEROCOPY
+        #endif
+        #ifdef HAVE_LINUX_NET_TSTAMP_H
+            #include <linux/net_tstamp.h>
+            #if defined(SO_TIMESTAMPING) && defined(SO_EE_ORIGIN_TIMESTAMPING)
+                #define HAVE_TX_TIMESTAMPS
+            #endif
+        #endif // HAVE_LINUX_NET_TSTAMP_H
+    #endif // HAVE_LINUX_ERRQUEUE_H
+
+    #ifdef HAVE_LINUX_FILTER_H
+        #include <linux/filter.h>
+        #if defined(SO_ATTACH_REUSEPORT_CBPF) && defined(SKF_AD_CPU)
+            #define HAVE_REUSEPORT_CBPF
+        #endif
+    #endif // HAVE_LINUX_FILTER_H
 
 SPECIAL_OSF1_EXTERN_C_START
     #include <arpa/inet.h>   /* netinet/in.h must be before this on SunOS */
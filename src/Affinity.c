@@ -0,0 +1,216 @@
+/*--------------------------------------------------------------- 
+ * Copyright (c) 1999,2000,2001,2002,2003                              
+ * The Board of Trustees of the University of Illinois            
+ * All Rights Reserved.                                           
+ *--------------------------------------------------------------- 
+ * Permission is hereby granted, free of charge, to any person    
+ * obtaining a copy of this software (Iperf) and associated       
+ * documentation files (the "Software"), to deal in the Software  
+ * without restriction, including without limitation the          
+ * rights to use, copy, modify, merge, publish, distribute,        
+ * sublicense, and/or sell copies of the Software, and to permit     
+ * persons to whom the Software is furnished to do
+ * so, subject to the following conditions: 
+ *
+ *     
+ * Redistributions of source code must retain the above 
+ * copyright notice, this list of conditions and 
+ * the following disclaimers. 
+ *
+ *     
+ * Redistributions in binary form must reproduce the above 
+ * copyright notice, this list of conditions and the following 
+ * disclaimers in the documentation and/or other materials 
+ * provided with the distribution. 
+ * 
+ *     
+ * Neither the names of the University of Illinois, NCSA, 
+ * nor the names of its contributors may be used to endorse 
+ * or promote products derived from this Software without
+ * specific prior written permission. 
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, 
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES 
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND 
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE CONTIBUTORS OR COPYRIGHT 
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, 
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, 
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE. 
+ * ________________________________________________________________
+ * National Laboratory for Applied Network Research 
+ * National Center for Supercomputing Applications 
+ * University of Illinois at Urbana-Champaign 
+ * http://www.ncsa.uiuc.edu
+ * ________________________________________________________________ 
+ * Affinity.c
+ * -------------------------------------------------------------------
+ * Thread placement for --affinity and --reporter-affinity. A pinned
+ * thread allocates and first touches its buffers itself, so they
+ * already come from its own NUMA node; Affinity_Place also binds
+ * them there in case the allocator hands back memory another thread
+ * touched first.
+ * ------------------------------------------------------------------- 
+ */
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE                 // cpu_set_t and sched_setaffinity
+#endif
+
+#include "Affinity.h"
+
+#ifdef HAVE_SCHED_SETAFFINITY
+#include <sched.h>
+#endif
+#ifdef HAVE_LINUX_MEMPOLICY_H
+#include <linux/mempolicy.h>
+#include <sys/syscall.h>
+#include <dirent.h>
+#endif
+
+int Affinity_Parse ( const char *list, int *cpus, int max ) {
+    const char *at = list;
+    char *end;
+    int count = 0;
+    long first, last;
+
+    if ( list == NULL ) {
+        return 0;
+    }
+    if ( strcmp( list, "rr" ) == 0 ) {
+#ifdef HAVE_SCHED_SETAFFINITY
+        cpu_set_t set;
+        int cpu;
+        CPU_ZERO( &set );
+        if ( sched_getaffinity( 0, sizeof(set), &set ) != 0 ) {
+            return 0;
+        }
+        for ( cpu = 0; cpu < CPU_SETSIZE && count < max; cpu++ ) {
+            if ( CPU_ISSET( cpu, &set ) ) {
+                cpus[count++] = cpu;
+            }
+        }
+#endif
+        return count;
+    }
+    while ( *at != '\0' ) {
+        first = strtol( at, &end, 10 );
+        if ( end == at || first < 0 ) {
+            return 0;
+        }
+        last = first;
+        if ( *end == '-' ) {
+            at = end + 1;
+            last = strtol( at, &end, 10 );
+            if ( end == at || last < first ) {
+                return 0;
+            }
+        }
+        if ( last >= AFFINITY_MAX_CPUS ) {
+            return 0;
+        }
+        for ( ; first <= last && count < max; first++ ) {
+            cpus[count++] = (int) first;
+        }
+        if ( *end == ',' ) {
+            end++;
+        } else if ( *end != '\0' ) {
+            return 0;
+        }
+        at = end;
+    }
+    return count;
+}
+
+void Affinity_Format ( const int *cpus, int count, char *out, int len ) {
+    int used = 0;
+    int i = 0;
+
+    out[0] = '\0';
+    while ( i < count && used < len ) {
+        int run = i;
+        while ( run + 1 < count && cpus[run + 1] == cpus[run] + 1 ) {
+            run++;
+        }
+        if ( run - i >= 2 ) {
+            used += snprintf( out + used, len - used, "%s%d-%d", 
+                              (used > 0 ? "," : ""), cpus[i], cpus[run] );
+            i = run + 1;
+        } else {
+            used += snprintf( out + used, len - used, "%s%d", 
+                              (used > 0 ? "," : ""), cpus[i] );
+            i++;
+        }
+    }
+}
+
+int Affinity_Pin ( const int *cpus, int count ) {
+#ifdef HAVE_SCHED_SETAFFINITY
+    cpu_set_t set;
+    int i;
+
+    CPU_ZERO( &set );
+    for ( i = 0; i < count; i++ ) {
+        if ( cpus[i] >= 0 && cpus[i] < CPU_SETSIZE ) {
+            CPU_SET( cpus[i], &set );
+        }
+    }
+    // pid 0 is the calling thread
+    if ( sched_setaffinity( 0, sizeof(set), &set ) != 0 ) {
+        return errno;
+    }
+    return 0;
+#else
+    return ENOSYS;
+#endif
+}
+
+int Affinity_Node ( int cpu ) {
+#ifdef HAVE_LINUX_MEMPOLICY_H
+    char path[64];
+    struct dirent *entry;
+    DIR *dir;
+    int node = -1;
+
+    // the CPU's directory links to its node as nodeN
+    snprintf( path, sizeof(path), "/sys/devices/system/cpu/cpu%d", cpu );
+    dir = opendir( path );
+    if ( dir == NULL ) {
+        return -1;
+    }
+    while ( (entry = readdir( dir )) != NULL ) {
+        if ( strncmp( entry->d_name, "node", 4 ) == 0 &&
+             isdigit( (unsigned char) entry->d_name[4] ) ) {
+            node = atoi( entry->d_name + 4 );
+            break;
+        }
+    }
+    closedir( dir );
+    return node;
+#else
+    return -1;
+#endif
+}
+
+void Affinity_Place ( void *addr, size_t len, int node ) {
+#if defined(HAVE_LINUX_MEMPOLICY_H) && defined(__NR_mbind)
+    unsigned long mask[ AFFINITY_MAX_CPUS / (8 * sizeof(unsigned long)) ];
+    long page = sysconf( _SC_PAGESIZE );
+    uintptr_t start, end;
+
+    if ( node < 0 || node >= AFFINITY_MAX_CPUS || page <= 0 ) {
+        return;
+    }
+    // only whole pages can be bound
+    start = ((uintptr_t) addr + page - 1) & ~((uintptr_t) page - 1);
+    end = ((uintptr_t) addr + len) & ~((uintptr_t) page - 1);
+    if ( end <= start ) {
+        return;
+    }
+    memset( mask, 0, sizeof(mask) );
+    mask[ node / (8 * sizeof(unsigned long)) ] |= 
+        1UL << (node % (8 * sizeof(unsigned long)));
+    syscall( __NR_mbind, start, end - start, MPOL_PREFERRED, mask,
+             (unsigned long) AFFINITY_MAX_CPUS, MPOL_MF_MOVE );
+#endif
+}
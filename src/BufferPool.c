@@ -0,0 +1,338 @@
+/*--------------------------------------------------------------- 
+ * Copyright (c) 1999,2000,2001,2002,2003                              
+ * The Board of Trustees of the University of Illinois            
+ * All Rights Reserved.                                           
+ *--------------------------------------------------------------- 
+ * Permission is hereby granted, free of charge, to any person    
+ * obtaining a copy of this software (Iperf) and associated       
+ * documentation files (the "Software"), to deal in the Software  
+ * without restriction, including without limitation the          
+ * rights to use, copy, modify, merge, publish, distribute,        
+ * sublicense, and/or sell copies of the Software, and to permit     
+ * persons to whom the Software is furnished to do
+ * so, subject to the following conditions: 
+ *
+ *     
+ * Redistributions of source code must retain the above 
+ * copyright notice, this list of conditions and 
+ * the following disclaimers. 
+ *
+ *     
+ * Redistributions in binary form must reproduce the above 
+ * copyright notice, this list of conditions and the following 
+ * disclaimers in the documentation and/or other materials 
+ * provided with the distribution. 
+ * 
+ *     
+ * Neither the names of the University of Illinois, NCSA, 
+ * nor the names of its contributors may be used to endorse 
+ * or promote products derived from this Software without
+ * specific prior written permission. 
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, 
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES 
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND 
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE CONTIBUTORS OR COPYRIGHT 
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, 
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, 
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE. 
+ * ________________________________________________________________
+ * National Laboratory for Applied Network Research 
+ * National Center for Supercomputing Applications 
+ * University of Illinois at Urbana-Champaign 
+ * http://www.ncsa.uiuc.edu
+ * ________________________________________________________________ 
+ * BufferPool.c
+ * -------------------------------------------------------------------
+ * Each buffer is preceded by a header, in the alignment gap before
+ * it, saying how to give it back. Buffers under a quarter of a chunk
+ * are cut from the current chunk and kept on a free list for their
+ * size when returned; chunks are never unmapped. Larger buffers are
+ * mapped on their own and unmapped when returned. Shared buffers
+ * live for the whole run.
+ * ------------------------------------------------------------------- 
+ */
+
+#include "BufferPool.h"
+#include "Affinity.h"
+#include "Mutex.h"
+#include "Thread.h"
+#include "util.h"
+
+#define POOL_CARVED 0
+#define POOL_MAPPED 1
+#define POOL_SHARED 2
+
+#define POOL_CLASSES 32             // buffer sizes with a free list
+#define POOL_SHARED_MAX 1024        // shared buffers, one per size and CPU
+
+typedef struct BufferPool_Header {
+    size_t size;                    // bytes after the header
+    void *base;                     // start of a POOL_MAPPED mapping
+    size_t mapped;                  // and its length
+    int kind;
+    struct BufferPool_Header *next; // free list
+} BufferPool_Header;
+
+typedef struct BufferPool_Class {
+    size_t size;
+    BufferPool_Header *free;
+} BufferPool_Class;
+
+typedef struct BufferPool_Shared {
+    size_t size;
+    int cpu;
+    char *buf;
+} BufferPool_Shared;
+
+static Mutex sPoolMutex;
+static int sHugeWanted = 0;
+static int sHugeGot = POOL_HUGE_NONE;
+static char *sChunk = NULL;         // being cut up
+static size_t sChunkUsed = 0;
+static BufferPool_Class sClasses[ POOL_CLASSES ];
+static int sClassCount = 0;
+static BufferPool_Shared sShared[ POOL_SHARED_MAX ];
+static int sSharedCount = 0;
+
+static void* BufferPool_map( size_t len, size_t *mapped );
+
+void BufferPool_Initialize ( int hugepages ) {
+    size_t mapped;
+
+    Mutex_Initialize( &sPoolMutex );
+    sHugeWanted = hugepages;
+    if ( sHugeWanted ) {
+        // map the first chunk now so the settings report can say
+        // which huge pages the buffers got
+        sChunk = (char*) BufferPool_map( POOL_CHUNK, &mapped );
+        sChunkUsed = 0;
+    }
+}
+
+static size_t BufferPool_align ( size_t size ) {
+    long page = 4096;
+#ifdef _SC_PAGESIZE
+    page = sysconf( _SC_PAGESIZE );
+#endif
+    return ( size >= (size_t) page ? (size_t) page : POOL_CACHE_LINE );
+}
+
+/*
+ * Map len bytes, a multiple of POOL_CHUNK with --hugepages, from
+ * explicit huge pages if the system has some reserved, else from
+ * transparent huge pages, else from normal pages
+ */
+static void* BufferPool_map ( size_t len, size_t *mapped ) {
+#if defined(HAVE_MMAP) && defined(HAVE_SYS_MMAN_H)
+    char *map = (char*) MAP_FAILED;
+
+    *mapped = len;
+#ifdef MAP_HUGETLB
+    if ( sHugeWanted ) {
+        map = (char*) mmap( NULL, len, PROT_READ | PROT_WRITE,
+                            MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0 );
+        if ( map != MAP_FAILED ) {
+            sHugeGot = POOL_HUGE_EXPLICIT;
+            return map;
+        }
+    }
+#endif
+#if defined(HAVE_MADVISE) && defined(MADV_HUGEPAGE)
+    if ( sHugeWanted ) {
+        // transparent huge pages need a POOL_CHUNK aligned range,
+        // so map a chunk extra and trim both ends to get one
+        char *start;
+        map = (char*) mmap( NULL, len + POOL_CHUNK, PROT_READ | PROT_WRITE,
+                            MAP_PRIVATE | MAP_ANONYMOUS, -1, 0 );
+        if ( map == MAP_FAILED ) {
+            return NULL;
+        }
+        start = (char*) (((uintptr_t) map + POOL_CHUNK - 1) & 
+                         ~((uintptr_t) POOL_CHUNK - 1));
+        if ( start > map ) {
+            munmap( map, start - map );
+        }
+        if ( start + len < map + len + POOL_CHUNK ) {
+            munmap( start + len, (map + len + POOL_CHUNK) - (start + len) );
+        }
+        if ( madvise( start, len, MADV_HUGEPAGE ) == 0 && 
+             sHugeGot == POOL_HUGE_NONE ) {
+            sHugeGot = POOL_HUGE_TRANSPARENT;
+        }
+        return start;
+    }
+#endif
+    map = (char*) mmap( NULL, len, PROT_READ | PROT_WRITE,
+                        MAP_PRIVATE | MAP_ANONYMOUS, -1, 0 );
+    return ( map == MAP_FAILED ? NULL : map );
+#else
+    *mapped = len;
+    return malloc( len );
+#endif
+}
+
+static void BufferPool_unmap ( void *base, size_t len ) {
+#if defined(HAVE_MMAP) && defined(HAVE_SYS_MMAN_H)
+    munmap( base, len );
+#else
+    free( base );
+#endif
+}
+
+/*
+ * Cut a buffer with its header from the current chunk, mapping
+ * a new chunk when this one is used up. Called with the lock held.
+ */
+static BufferPool_Header* BufferPool_carve ( size_t size, size_t align ) {
+    size_t at;
+    size_t mapped;
+    BufferPool_Header *hdr;
+
+    // the data starts aligned, one alignment unit past the last buffer
+    at = (((uintptr_t) sChunk + sChunkUsed + align - 1) & ~(align - 1)) - 
+         (uintptr_t) sChunk + align;
+    if ( sChunk == NULL || at + size > POOL_CHUNK ) {
+        sChunk = (char*) BufferPool_map( POOL_CHUNK, &mapped );
+        if ( sChunk == NULL ) {
+            return NULL;
+        }
+        at = (((uintptr_t) sChunk + align - 1) & ~(align - 1)) - 
+             (uintptr_t) sChunk + align;
+    }
+    hdr = (BufferPool_Header*) (sChunk + at) - 1;
+    hdr->size = size;
+    hdr->base = NULL;
+    hdr->mapped = 0;
+    hdr->kind = POOL_CARVED;
+    hdr->next = NULL;
+    sChunkUsed = at + size;
+    return hdr;
+}
+
+static BufferPool_Header* BufferPool_get ( size_t size ) {
+    size_t align = BufferPool_align( size );
+    BufferPool_Header *hdr = NULL;
+    int i;
+
+    size = (size + align - 1) & ~(align - 1);
+    if ( size == 0 ) {
+        size = align;
+    }
+    if ( size + align <= POOL_CHUNK / 4 ) {
+        // reuse one of this size
+        for ( i = 0; i < sClassCount; i++ ) {
+            if ( sClasses[i].size == size ) {
+                break;
+            }
+        }
+        if ( i < sClassCount && sClasses[i].free != NULL ) {
+            hdr = sClasses[i].free;
+            sClasses[i].free = hdr->next;
+            hdr->next = NULL;
+            return hdr;
+        }
+        if ( i < sClassCount || sClassCount < POOL_CLASSES ) {
+            if ( i == sClassCount ) {
+                sClasses[i].size = size;
+                sClasses[i].free = NULL;
+                sClassCount++;
+            }
+            return BufferPool_carve( size, align );
+        }
+    }
+
+    // a mapping of its own, with its header in the first alignment unit
+    {
+        size_t len = size + align;
+        size_t mapped;
+        char *base;
+
+        if ( sHugeWanted ) {
+            len = (len + POOL_CHUNK - 1) & ~((size_t) POOL_CHUNK - 1);
+        }
+        base = (char*) BufferPool_map( len, &mapped );
+        if ( base == NULL ) {
+            return NULL;
+        }
+        hdr = (BufferPool_Header*) (base + align) - 1;
+        hdr->size = size;
+        hdr->base = base;
+        hdr->mapped = mapped;
+        hdr->kind = POOL_MAPPED;
+        hdr->next = NULL;
+    }
+    return hdr;
+}
+
+char* BufferPool_Get ( size_t size ) {
+    BufferPool_Header *hdr;
+
+    Mutex_Lock( &sPoolMutex );
+    hdr = BufferPool_get( size );
+    Mutex_Unlock( &sPoolMutex );
+    FAIL_errno( hdr == NULL, "No memory for buffer\n", NULL );
+    return (char*) (hdr + 1);
+}
+
+char* BufferPool_GetShared ( size_t size, int cpu ) {
+    BufferPool_Header *hdr;
+    int i;
+
+    if ( cpu < 0 ) {
+        cpu = -1;
+    }
+    Mutex_Lock( &sPoolMutex );
+    for ( i = 0; i < sSharedCount; i++ ) {
+        if ( sShared[i].size == size && sShared[i].cpu == cpu ) {
+            Mutex_Unlock( &sPoolMutex );
+            return sShared[i].buf;
+        }
+    }
+    hdr = BufferPool_get( size );
+    if ( hdr != NULL && sSharedCount < POOL_SHARED_MAX ) {
+        hdr->kind = POOL_SHARED;
+        sShared[sSharedCount].size = size;
+        sShared[sSharedCount].cpu = cpu;
+        sShared[sSharedCount].buf = (char*) (hdr + 1);
+        sSharedCount++;
+        if ( cpu >= 0 ) {
+            // placed once, here, as every later user is on this CPU
+            Affinity_Place( hdr + 1, size, Affinity_Node( cpu ) );
+        }
+    }
+    Mutex_Unlock( &sPoolMutex );
+    FAIL_errno( hdr == NULL, "No memory for buffer\n", NULL );
+    return (char*) (hdr + 1);
+}
+
+void BufferPool_Put ( char *buf ) {
+    BufferPool_Header *hdr;
+    int i;
+
+    if ( buf == NULL ) {
+        return;
+    }
+    hdr = (BufferPool_Header*) buf - 1;
+    if ( hdr->kind == POOL_SHARED ) {
+        return;
+    }
+    if ( hdr->kind == POOL_MAPPED ) {
+        BufferPool_unmap( hdr->base, hdr->mapped );
+        return;
+    }
+    Mutex_Lock( &sPoolMutex );
+    for ( i = 0; i < sClassCount; i++ ) {
+        if ( sClasses[i].size == hdr->size ) {
+            hdr->next = sClasses[i].free;
+            sClasses[i].free = hdr;
+            break;
+        }
+    }
+    Mutex_Unlock( &sPoolMutex );
+}
+
+int BufferPool_HugePages ( void ) {
+    return sHugeGot;
+}
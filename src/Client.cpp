@@ -57,10 +57,27 @@
 #include "SocketAddr.h"
 #include "PerfSocket.hpp"
 #include "Extractor.h"
+#include "TokenBucket.hpp"
+#include "Distribution.hpp"
+#include "SizeMix.hpp"
+#include "Trace.h"
+#include "IOUring.h"
+#include "Affinity.h"
+#include "BufferPool.h"
+#include "Verify.h"
+#include "KernelStamp.h"
 #include "delay.hpp"
 #include "util.h"
 #include "Locale.h"
 
+const int    kGSO_MaxBytes    = 65507;  // largest UDP payload over IPv4
+const int    kGSO_MaxSegments = 64;     // UDP_MAX_SEGMENTS in the Linux kernel
+const int    kZeroCopy_Buffers = 16;    // --zerocopy send buffers in flight
+const int    kZeroCopy_Wait   = 1000;   // ms to wait for a completion
+const int    kIOUring_Slots   = 16;     // --io-uring writes queued per chain
+const int    kTxStamp_Slots   = 1024;   // --tx-timestamps writes awaiting a stamp
+const int    kFIN_Tries       = 10;     // UDP FINs sent before giving up on an ack
+
 /* -------------------------------------------------------------------
  * Store server hostname, optionally local hostname, and socket info.
  * ------------------------------------------------------------------- */
@@ -69,9 +86,157 @@ Client::Client( thread_Settings *inSettings ) {
     mSettings = inSettings;
     mBuf = NULL;
 
-    // initialize buffer
-    mBuf = new char[ mSettings->mBufLen ];
-    pattern( mBuf, mSettings->mBufLen );
+    // --isochronous needs the client_hdr and the frame header
+    // in every datagram
+    if ( isIsochronous( mSettings ) ) {
+        if ( !isUDP( mSettings ) || isCompat( mSettings ) ||
+             mSettings->mBufLen < (int) (sizeof(UDP_datagram) + sizeof(client_hdr) 
+                                         + sizeof(isoch_hdr)) ) {
+            fprintf( stderr, warn_isochronous_unsupported );
+            unsetIsochronous( mSettings );
+        } else {
+            // bursts go out one datagram at a time
+            mSettings->mBatchSize = 1;
+            unsetUDPGSO( mSettings );
+        }
+    }
+
+    // --trace replays each packet on its own, at its own size
+    if ( isTrace( mSettings ) ) {
+        if ( !isUDP( mSettings ) ) {
+            fprintf( stderr, warn_trace_unsupported );
+            unsetTrace( mSettings );
+        } else if ( !Trace_Initialize( mSettings->mTraceName, mSettings ) ) {
+            unsetTrace( mSettings );
+        } else {
+            mSettings->mBatchSize = 1;
+            unsetUDPGSO( mSettings );
+            unsetIsochronous( mSettings );
+        }
+    }
+
+    // --size-mix varies each write, so datagrams go out one at a
+    // time, and frames, traces and file data keep their own sizes
+    if ( mSettings->mSizeCount > 0 ) {
+        if ( isIsochronous( mSettings ) || isTrace( mSettings ) || 
+             isFileInput( mSettings ) ) {
+            mSettings->mSizeCount = 0;
+        } else if ( isUDP( mSettings ) ) {
+            mSettings->mBatchSize = 1;
+            unsetUDPGSO( mSettings );
+        }
+    }
+
+    // --verify fills each write as it goes, so it needs generated
+    // data sent one write at a time from mBuf
+    if ( mSettings->mVerify ) {
+        if ( isFileInput( mSettings ) || isIsochronous( mSettings ) || 
+             isTrace( mSettings ) ) {
+            fprintf( stderr, warn_verify_unsupported );
+            mSettings->mVerify = 0;
+        } else {
+            unsetIOUring( mSettings );
+            if ( isUDP( mSettings ) ) {
+                mSettings->mBatchSize = 1;
+                unsetUDPGSO( mSettings );
+            }
+        }
+    }
+
+    // --tx-timestamps matches each stamp to the write it numbers, so
+    // datagrams go out one write at a time from Run's loop
+    if ( mSettings->mTxStamps ) {
+        if ( !isUDP( mSettings ) || isIsochronous( mSettings ) || 
+             isTrace( mSettings ) || mSettings->mWorkers > 0 ) {
+            fprintf( stderr, warn_txstamps_unsupported, "needs plain UDP sends" );
+            mSettings->mTxStamps = 0;
+        } else {
+            unsetIOUring( mSettings );
+            mSettings->mBatchSize = 1;
+            unsetUDPGSO( mSettings );
+        }
+    }
+
+    // --io-uring queues whole writes from its own slots, so file
+    // data, sendfile, zerocopy, frames and traces keep their loops
+    if ( isIOUring( mSettings ) ) {
+#ifdef HAVE_IO_URING
+        if ( isFileInput( mSettings ) || isSendFile( mSettings ) || 
+             isZeroCopy( mSettings ) || isIsochronous( mSettings ) || 
+             isTrace( mSettings ) ) {
+            unsetIOUring( mSettings );
+        } else if ( isUDP( mSettings ) ) {
+            mSettings->mBatchSize = 1;
+            unsetUDPGSO( mSettings );
+        }
+#else
+        fprintf( stderr, warn_iouring_unsupported, strerror( ENOSYS ) );
+        unsetIOUring( mSettings );
+#endif
+    }
+
+    // with UDP GSO a batch is one segmented write, so size it to
+    // the largest the kernel accepts unless --udp-batch chose less
+    if ( isUDP( mSettings ) && isUDPGSO( mSettings ) ) {
+        int segments = kGSO_MaxBytes / mSettings->mBufLen;
+        if ( segments > kGSO_MaxSegments ) {
+            segments = kGSO_MaxSegments;
+        }
+        if ( mSettings->mBatchSize == 1 || mSettings->mBatchSize > segments ) {
+            mSettings->mBatchSize = segments;
+        }
+        if ( mSettings->mBatchSize < 2 ) {
+            unsetUDPGSO( mSettings );
+        }
+    }
+
+    // initialize buffer, one datagram slot per batch entry
+    // and for --trace and --size-mix room for the largest write
+    int slots = ( isUDP( mSettings ) ? mSettings->mBatchSize : 1 );
+    int size = mSettings->mBufLen * slots;
+    if ( isTrace( mSettings ) && size < kGSO_MaxBytes ) {
+        size = kGSO_MaxBytes;
+    }
+    for ( int i = 0; i < mSettings->mSizeCount; i++ ) {
+        if ( size < mSettings->mSizes[i] ) {
+            size = mSettings->mSizes[i];
+        }
+    }
+    mBuf = BufferPool_Get( size );
+    if ( mSettings->mCPU >= 0 ) {
+        // keep it on the NUMA node of the --affinity CPU
+        Affinity_Place( mBuf, size, Affinity_Node( mSettings->mCPU ) );
+    }
+    pattern( mBuf, size );
+
+    mZCPool = NULL;
+    mZCPoolSeq = NULL;
+    mZCNext = 0;
+    mZCSent = 0;
+    mZCDone = 0;
+    mZCZeroCopy = 0;
+    mZCCopied = 0;
+
+    memset( &mDelay, 0, sizeof(mDelay) );
+    mDelay.spin = mSettings->mDelaySpin;
+    mCPUStart = -1;
+    mStreamReport = NULL;
+    mStreamTotal = 0;
+    mStreamFINs = 0;
+    mTxSent = NULL;
+    mTxDelays = NULL;
+    mTxNext = 0;
+    mTxHead = 0;
+    mTxCount = 0;
+    if ( !isUDP( mSettings ) && isZeroCopy( mSettings ) ) {
+        mZCPool = new char*[ kZeroCopy_Buffers ];
+        mZCPoolSeq = new u_int32_t[ kZeroCopy_Buffers ];
+        for ( int i = 0; i < kZeroCopy_Buffers; i++ ) {
+            mZCPool[i] = BufferPool_Get( size );
+            memcpy( mZCPool[i], mBuf, size );
+            mZCPoolSeq[i] = 0;
+        }
+    }
     if ( isFileInput( mSettings ) ) {
         if ( !isSTDIN( mSettings ) )
             Extractor_Initialize( mSettings->mFileName, mSettings->mBufLen, mSettings );
@@ -82,10 +247,28 @@ Client::Client( thread_Settings *inSettings ) {
             unsetFileInput( mSettings );
         }
     }
+    if ( isSendFile( mSettings ) && 
+         (!isFileInput( mSettings ) || isSTDIN( mSettings ) || isUDP( mSettings )) ) {
+        // sendfile() only sends a file to a TCP stream
+        unsetSendFile( mSettings );
+    }
 
     // connect
     Connect( );
 
+    // the server reads datagrams of at most its -l, a larger one is cut
+    if ( isUDP( mSettings ) && mSettings->mSizeCount > 0 ) {
+        int largest = 0;
+        for ( int i = 0; i < mSettings->mSizeCount; i++ ) {
+            if ( largest < mSettings->mSizes[i] - SizeMix::overhead( mSettings ) ) {
+                largest = mSettings->mSizes[i] - SizeMix::overhead( mSettings );
+            }
+        }
+        if ( largest > mSettings->mBufLen ) {
+            fprintf( stderr, warn_size_mix_len, largest, mSettings->mBufLen, largest );
+        }
+    }
+
     if ( isReport( inSettings ) ) {
         ReportSettings( inSettings );
         if ( mSettings->multihdr && isMultipleReport( inSettings ) ) {
@@ -109,7 +292,22 @@ Client::~Client() {
         WARN_errno( rc == SOCKET_ERROR, "close" );
         mSettings->mSock = INVALID_SOCKET;
     }
-    DELETE_ARRAY( mBuf );
+    if ( isFileInput( mSettings ) ) {
+        Extractor_Destroy( mSettings );
+    }
+    if ( isTrace( mSettings ) ) {
+        Trace_Destroy( mSettings );
+    }
+    BufferPool_Put( mBuf );
+    if ( mZCPool != NULL ) {
+        for ( int i = 0; i < kZeroCopy_Buffers; i++ ) {
+            BufferPool_Put( mZCPool[i] );
+        }
+        DELETE_ARRAY( mZCPool );
+        DELETE_ARRAY( mZCPoolSeq );
+    }
+    DELETE_ARRAY( mTxSent );
+    DELETE_ARRAY( mTxDelays );
 } // end ~Client
 
 const double kSecs_to_usecs = 1e6; 
@@ -117,6 +315,7 @@ const int    kBytes_to_Bits = 8;
 
 void Client::RunTCP( void ) {
     long currLen = 0; 
+    long delay = 0; 
     struct itimerval it;
     max_size_t totLen = 0;
 
@@ -132,9 +331,17 @@ void Client::RunTCP( void ) {
 
     // InitReport handles Barrier for multiple Streams
     mSettings->reporthdr = InitReport( mSettings );
+    mCPUStart = delay_cputime();
     reportstruct = new ReportStruct;
     reportstruct->packetID = 0;
 
+    // -b rate limit, paced on the bytes each write accepted
+    // unless the kernel is pacing the socket (--fq-rate)
+    TokenBucket pacer( (mSettings->mFQPacingRate > 0 ? 0 : mSettings->mUDPRate),
+                       mSettings->mBurstSize, mSettings->mBufLen );
+    // --size-mix picks each write's size
+    SizeMix mix( mSettings, 1 );
+
     lastPacketTime.setnow();
     if ( mMode_Time ) {
 	memset (&it, 0, sizeof (it));
@@ -148,25 +355,77 @@ void Client::RunTCP( void ) {
 	}
     }
     do {
+        int writeLen = ( mix.active() ? mix.next() : mSettings->mBufLen );
+
+        // with --zerocopy each send goes from the next free pool buffer
+        if ( isZeroCopy( mSettings ) ) {
+            readAt = ZeroCopyBuffer();
+        }
+
         // Read the next data block from 
         // the file if it's file input 
-        if ( isFileInput( mSettings ) ) {
-            Extractor_getNextDataBlock( readAt, mSettings ); 
+        if ( isFileInput( mSettings ) && !isSendFile( mSettings ) ) {
+            if ( Extractor_isMapped( mSettings ) && !isZeroCopy( mSettings ) ) {
+                // write straight from the mapped file
+                readAt = Extractor_getNextDataPointer( &writeLen, 
+                                                       mSettings->mBufLen, mSettings );
+            } else {
+                Extractor_getNextDataBlock( readAt, mSettings ); 
+            }
             canRead = Extractor_canRead( mSettings ) != 0; 
         } else
             canRead = true; 
 
+        // --verify, the next writeLen bytes of the checksummed stream
+        if ( mSettings->mVerify ) {
+            Verify_FillStream( readAt, writeLen, totLen );
+        }
+
         // perform write 
-        currLen = write( mSettings->mSock, mBuf, mSettings->mBufLen ); 
+        if ( isSendFile( mSettings ) ) {
+            // straight from the page cache to the socket
+            currLen = Extractor_sendNextDataBlock( mSettings->mSock, mSettings );
+            if ( currLen < 0 && (errno == EINVAL || errno == ESPIPE || errno == ENOSYS) ) {
+                // not a file sendfile() can send, read it instead
+                fprintf( stderr, warn_sendfile_failed, strerror( errno ) );
+                unsetSendFile( mSettings );
+                fseek( mSettings->Extractor_file, mSettings->Extractor_offset, SEEK_SET );
+                continue;
+            }
+            if ( currLen == 0 ) {
+                canRead = false;
+            }
+        } else
+#ifdef HAVE_MSG_ZEROCOPY
+        if ( isZeroCopy( mSettings ) ) {
+            currLen = send( mSettings->mSock, readAt, writeLen, MSG_ZEROCOPY );
+            while ( currLen < 0 && errno == ENOBUFS && !sInterupted ) {
+                // out of option memory for pinned pages, wait for some back
+                ZeroCopyReap( true );
+                currLen = send( mSettings->mSock, readAt, writeLen, MSG_ZEROCOPY );
+            }
+            if ( currLen >= 0 ) {
+                mZCSent++;
+            }
+        } else
+#endif
+        currLen = write( mSettings->mSock, readAt, writeLen ); 
         if ( currLen < 0 ) {
             WARN_errno( currLen < 0, "write2" ); 
             break; 
         }
 	totLen += currLen;
+        mix.sent( currLen );
+
+        // hold off the next write until the bucket is out of debt
+        delay = pacer.consume( currLen );
+        if ( delay > 0 ) {
+            delay_loop_stats( delay, &mDelay );
+        }
 
 	//if(mSettings->mInterval > 0) {
         if (periodicReport) {
-    	    gettimeofday( &(reportstruct->packetTime), NULL );
+    	    gettime_monotonic( &(reportstruct->packetTime) );
             reportstruct->packetLen = currLen;
             ReportPacket( mSettings->reporthdr, reportstruct );
         }	
@@ -179,13 +438,29 @@ void Client::RunTCP( void ) {
                    (!mMode_Time  &&  0 >= mSettings->mAmount)) && canRead ); 
 
     // stop timing
-    gettimeofday( &(reportstruct->packetTime), NULL );
+    gettime_monotonic( &(reportstruct->packetTime) );
 
     // if we're not doing interval reporting, report the entire transfer as one big packet
     if(0.0 == mSettings->mInterval) {
         reportstruct->packetLen = totLen;
         ReportPacket( mSettings->reporthdr, reportstruct );
     }
+    if ( isZeroCopy( mSettings ) ) {
+        // collect the outstanding completions so the counts are whole
+        u_int32_t done;
+        do {
+            done = mZCDone;
+            ZeroCopyReap( true );
+        } while ( mZCDone < mZCSent && mZCDone != done );
+        if ( mSettings->reporthdr != NULL ) {
+            mSettings->reporthdr->report.info.cntZeroCopy = mZCZeroCopy;
+            mSettings->reporthdr->report.info.cntCopied = mZCCopied;
+        }
+    }
+    if ( mix.active() && mSettings->reporthdr != NULL ) {
+        mix.report( &mSettings->reporthdr->report.info );
+    }
+    PacingReport();
     CloseReport( mSettings->reporthdr, reportstruct );
 
     DELETE_PTR( reportstruct );
@@ -202,18 +477,32 @@ void Client::Run( void ) {
     struct UDP_datagram* mBuf_UDP = (struct UDP_datagram*) mBuf; 
     long currLen = 0; 
 
-    int delay_target = 0; 
-    int delay = 0; 
-    int adjust = 0; 
+    long delay = 0; 
 
     char* readAt = mBuf;
 
+    if ( isIOUring( mSettings ) ) {
+        RunURing();
+        return;
+    }
 #if HAVE_THREAD
     if ( !isUDP( mSettings ) ) {
 	RunTCP();
 	return;
     }
 #endif
+    if ( isUDP( mSettings ) && isTrace( mSettings ) ) {
+        RunTrace();
+        return;
+    }
+    if ( isUDP( mSettings ) && isIsochronous( mSettings ) ) {
+        RunIsochronous();
+        return;
+    }
+    if ( isUDP( mSettings ) && mSettings->mBatchSize > 1 ) {
+        RunUDPBatch();
+        return;
+    }
     
     // Indicates if the stream is readable 
     bool canRead = true, mMode_Time = isModeTime( mSettings ); 
@@ -224,19 +513,21 @@ void Client::Run( void ) {
         mEndTime.add( mSettings->mAmount / 100.0 );
     }
 
+    // bandwidth restriction, paced one datagram (or TCP write) at a time
+    // unless the kernel is pacing the socket (--fq-rate)
+    TokenBucket pacer( (mSettings->mFQPacingRate > 0 ? 0 : mSettings->mUDPRate),
+                       mSettings->mBurstSize, mSettings->mBufLen );
+    // --gap-dist spreads the same mean rate over random gaps
+    Distribution gaps( mSettings->mGapDist, mSettings->mGapShape, mSettings->mSeed );
+    // --size-mix picks each write's size, datagrams keep their headers
+    SizeMix mix( mSettings, (!isUDP( mSettings ) ? 1 : 
+                             isCompat( mSettings ) ? sizeof(struct UDP_datagram) :
+                             sizeof(struct UDP_datagram) + sizeof(struct client_hdr)) );
+
     if ( isUDP( mSettings ) ) {
         // Due to the UDP timestamps etc, included 
         // reduce the read size by an amount 
         // equal to the header size
-    
-        // compute delay for bandwidth restriction, constrained to [0,1] seconds 
-        delay_target = (int) ( mSettings->mBufLen * ((kSecs_to_usecs * kBytes_to_Bits) 
-                                                     / mSettings->mUDPRate) ); 
-        if ( delay_target < 0  || 
-             delay_target > (int) 1 * kSecs_to_usecs ) {
-            fprintf( stderr, warn_delay_large, delay_target / kSecs_to_usecs ); 
-            delay_target = (int) kSecs_to_usecs * 1; 
-        }
         if ( isFileInput( mSettings ) ) {
             if ( isCompat( mSettings ) ) {
                 Extractor_reduceReadSize( sizeof(struct UDP_datagram), mSettings );
@@ -254,12 +545,18 @@ void Client::Run( void ) {
 
     // InitReport handles Barrier for multiple Streams
     mSettings->reporthdr = InitReport( mSettings );
+    mCPUStart = delay_cputime();
     reportstruct = new ReportStruct;
     reportstruct->packetID = 0;
+    reportstruct->txDelay = -1;
+    if ( mSettings->mTxStamps ) {
+        TxStampStart();
+    }
 
     lastPacketTime.setnow();
     
     do {
+        int writeLen = ( mix.active() ? mix.next() : mSettings->mBufLen );
 
         // Test case: drop 17 packets and send 2 out-of-order: 
         // sequence 51, 52, 70, 53, 54, 71, 72 
@@ -269,23 +566,24 @@ void Client::Run( void ) {
         //  case 55: datagramID = 71; break; 
         //  default: break; 
         //} 
-        gettimeofday( &(reportstruct->packetTime), NULL );
+        // wait until the bucket holds enough tokens for this write 
+        delay = pacer.consume( writeLen * gaps.next() ); 
+        if ( delay > 0 ) {
+            delay_loop_stats( delay, &mDelay ); 
+        }
+
+        gettime_monotonic( &(reportstruct->packetTime) );
 
         if ( isUDP( mSettings ) ) {
-            // store datagram ID into buffer 
+            // store datagram ID and wall clock send time into buffer 
+            gettimeofday( &(reportstruct->sentTime), NULL );
             mBuf_UDP->id      = htonl( (reportstruct->packetID)++ ); 
-            mBuf_UDP->tv_sec  = htonl( reportstruct->packetTime.tv_sec ); 
-            mBuf_UDP->tv_usec = htonl( reportstruct->packetTime.tv_usec );
-
-            // delay between writes 
-            // make an adjustment for how long the last loop iteration took 
-            // TODO this doesn't work well in certain cases, like 2 parallel streams 
-            adjust = delay_target + lastPacketTime.subUsec( reportstruct->packetTime ); 
-            lastPacketTime.set( reportstruct->packetTime.tv_sec, 
-                                reportstruct->packetTime.tv_usec ); 
-
-            if ( adjust > 0  ||  delay > 0 ) {
-                delay += adjust; 
+            mBuf_UDP->tv_sec  = htonl( reportstruct->sentTime.tv_sec ); 
+            mBuf_UDP->tv_usec = htonl( reportstruct->sentTime.tv_usec );
+            if ( mSettings->mVerify && 
+                 writeLen >= (int) (sizeof(UDP_datagram) + sizeof(u_int32_t)) ) {
+                Verify_FillDatagram( mBuf, writeLen, sizeof(UDP_datagram) + sizeof(client_hdr),
+                                     ntohl( mBuf_UDP->id ) );
             }
         }
 
@@ -298,7 +596,10 @@ void Client::Run( void ) {
             canRead = true; 
 
         // perform write 
-        currLen = write( mSettings->mSock, mBuf, mSettings->mBufLen ); 
+        if ( mTxSent != NULL ) {
+            TxStampWrite();
+        }
+        currLen = write( mSettings->mSock, mBuf, writeLen ); 
 #if defined(WIN32) || defined(_WIN32_WCE)
 		if ( currLen < 0) {
 #else
@@ -307,14 +608,19 @@ void Client::Run( void ) {
             WARN_errno( currLen < 0, "write2" ); 
             break; 
         }
+        if ( mTxSent != NULL ) {
+            // a write the qdisc dropped (ENOBUFS) was numbered too,
+            // then hand on a stamped delay, usually this write's own
+            mTxNext++;
+            TxStampReap();
+            reportstruct->txDelay = TxStampDelay();
+        }
 
         // report packets 
         reportstruct->packetLen = currLen;
         ReportPacket( mSettings->reporthdr, reportstruct );
+        mix.sent( currLen );
         
-        if ( delay > 0 ) {
-            delay_loop( delay ); 
-        }
         if ( !mMode_Time ) {
             mSettings->mAmount -= currLen;
         }
@@ -324,30 +630,926 @@ void Client::Run( void ) {
                  (!mMode_Time  &&  0 >= mSettings->mAmount)) && canRead ); 
 
     // stop timing
-    gettimeofday( &(reportstruct->packetTime), NULL );
-    CloseReport( mSettings->reporthdr, reportstruct );
+    gettime_monotonic( &(reportstruct->packetTime) );
+    if ( mix.active() && mSettings->reporthdr != NULL ) {
+        mix.report( &mSettings->reporthdr->report.info );
+    }
+    Finish( reportstruct );
+
+    DELETE_PTR( reportstruct );
+    EndReport( mSettings->reporthdr );
+} 
+// end Run
+
+/* ------------------------------------------------------------------- 
+ * Send isochronous UDP traffic: every 1/mFPS seconds a frame of
+ * mFrameBurst datagrams goes out back-to-back, the way video or
+ * telemetry is sent. Frames are due at fixed offsets from the first,
+ * so a late frame does not push back the ones after it. Each datagram
+ * carries its frame number and the frame start time in an isoch_hdr
+ * so the server can report per-frame latency and loss.
+ * ------------------------------------------------------------------- */ 
+
+void Client::RunIsochronous( void ) {
+    struct UDP_datagram* mBuf_UDP = (struct UDP_datagram*) mBuf; 
+    isoch_hdr* mBuf_isoch = (isoch_hdr*) (((client_hdr*) (mBuf_UDP + 1)) + 1);
+    int hdrLen = sizeof(UDP_datagram) + sizeof(client_hdr) + sizeof(isoch_hdr);
+    long currLen = 0; 
+    int frameID = 0;
+    int i;
+    struct timeval frameTime;
+
+    // Indicates if the stream is readable 
+    bool canRead = true, mMode_Time = isModeTime( mSettings ); 
+
+    // setup termination variables
+    if ( mMode_Time ) {
+        mEndTime.setnow();
+        mEndTime.add( mSettings->mAmount / 100.0 );
+    }
+
+    // leave the headers alone when reading file input
+    if ( isFileInput( mSettings ) ) {
+        Extractor_reduceReadSize( hdrLen, mSettings );
+    }
+
+    ReportStruct *reportstruct = NULL;
+
+    mSettings->reporthdr = InitReport( mSettings );
+    mCPUStart = delay_cputime();
+    reportstruct = new ReportStruct;
+    reportstruct->packetID = 0;
+
+    Timestamp nextFrame;
+    double period = 1.0 / mSettings->mFPS;
+
+    do {
+        // wait until the frame is due
+        Timestamp now;
+        if ( now.before( nextFrame ) ) {
+            delay_loop_stats( nextFrame.subUsec( now ), &mDelay );
+        }
+        nextFrame.add( period );
+
+        gettimeofday( &frameTime, NULL );
+        frameID++;
+        mBuf_isoch->frameid       = htonl( frameID );
+        mBuf_isoch->burstsize     = htonl( mSettings->mFrameBurst );
+        mBuf_isoch->start_tv_sec  = htonl( frameTime.tv_sec );
+        mBuf_isoch->start_tv_usec = htonl( frameTime.tv_usec );
+
+        // the whole burst goes out, even past the end of the test,
+        // so the server never sees the last frame as lossy
+        for ( i = 0; i < mSettings->mFrameBurst && canRead; i++ ) {
+            gettime_monotonic( &(reportstruct->packetTime) );
+            gettimeofday( &(reportstruct->sentTime), NULL );
+            mBuf_UDP->id      = htonl( (reportstruct->packetID)++ ); 
+            mBuf_UDP->tv_sec  = htonl( reportstruct->sentTime.tv_sec ); 
+            mBuf_UDP->tv_usec = htonl( reportstruct->sentTime.tv_usec );
+
+            // Read the next data block from 
+            // the file if it's file input 
+            if ( isFileInput( mSettings ) ) {
+                Extractor_getNextDataBlock( mBuf + hdrLen, mSettings ); 
+                canRead = Extractor_canRead( mSettings ) != 0; 
+            }
+
+            currLen = write( mSettings->mSock, mBuf, mSettings->mBufLen ); 
+            if ( currLen < 0 && errno != ENOBUFS ) {
+                WARN_errno( currLen < 0, "write2" ); 
+                canRead = false;
+                break; 
+            }
+
+            // report packets 
+            reportstruct->packetLen = currLen;
+            ReportPacket( mSettings->reporthdr, reportstruct );
+
+            if ( !mMode_Time ) {
+                mSettings->mAmount -= currLen;
+            }
+        }
+
+    } while ( ! (sInterupted  || 
+                 (mMode_Time   &&  mEndTime.before( reportstruct->packetTime ))  || 
+                 (!mMode_Time  &&  0 >= (int64_t) mSettings->mAmount)) && canRead ); 
+
+    // stop timing
+    gettime_monotonic( &(reportstruct->packetTime) );
+    Finish( reportstruct );
+
+    DELETE_PTR( reportstruct );
+    EndReport( mSettings->reporthdr );
+}
+// end RunIsochronous
+
+/* ------------------------------------------------------------------- 
+ * Replay a --trace. Each record is sent as one datagram of the
+ * record's size when its offset from the first record has passed,
+ * with the usual datagram ID and timestamp so the server reports
+ * loss and jitter as for any UDP test. The test ends at the end of
+ * the trace or at -t / -n, whichever comes first.
+ * ------------------------------------------------------------------- */ 
+
+void Client::RunTrace( void ) {
+    struct UDP_datagram* mBuf_UDP = (struct UDP_datagram*) mBuf; 
+    long currLen = 0; 
+    double offset = 0;
+    int len = 0;
+    bool warnedLen = false, warnedMax = false;
+
+    // datagrams carry at least the headers, the first one
+    // holds the client_hdr the server looks for
+    int minLen = sizeof(UDP_datagram);
+    if ( !isCompat( mSettings ) ) {
+        minLen += sizeof(client_hdr);
+    }
+
+    // Indicates if the stream is readable 
+    bool canRead = true, mMode_Time = isModeTime( mSettings ); 
+
+    ReportStruct *reportstruct = NULL;
+
+    mSettings->reporthdr = InitReport( mSettings );
+    mCPUStart = delay_cputime();
+    reportstruct = new ReportStruct;
+    reportstruct->packetID = 0;
+
+    // the trace is timed from here
+    Timestamp start;
+    if ( mMode_Time ) {
+        mEndTime = start;
+        mEndTime.add( mSettings->mAmount / 100.0 );
+    }
+
+    while ( canRead && !sInterupted && 
+            (mMode_Time || 0 < (int64_t) mSettings->mAmount) ) {
+        if ( !Trace_getNextRecord( &offset, &len, mSettings ) ) {
+            break;
+        }
+        if ( len < minLen ) {
+            len = minLen;
+        } else if ( len > kGSO_MaxBytes ) {
+            if ( !warnedMax ) {
+                fprintf( stderr, warn_trace_max, len, kGSO_MaxBytes );
+                warnedMax = true;
+            }
+            len = kGSO_MaxBytes;
+        }
+        // the server reads datagrams of at most its -l, a larger one is cut
+        if ( len > mSettings->mBufLen && !warnedLen ) {
+            fprintf( stderr, warn_trace_len, len, mSettings->mBufLen, kGSO_MaxBytes );
+            warnedLen = true;
+        }
+
+        // wait until the packet is due
+        Timestamp due = start;
+        due.add( offset );
+        if ( mMode_Time && mEndTime.before( due ) ) {
+            break;
+        }
+        Timestamp now;
+        if ( now.before( due ) ) {
+            delay_loop_stats( due.subUsec( now ), &mDelay );
+        }
+
+        gettime_monotonic( &(reportstruct->packetTime) );
+        gettimeofday( &(reportstruct->sentTime), NULL );
+        mBuf_UDP->id      = htonl( (reportstruct->packetID)++ ); 
+        mBuf_UDP->tv_sec  = htonl( reportstruct->sentTime.tv_sec ); 
+        mBuf_UDP->tv_usec = htonl( reportstruct->sentTime.tv_usec );
+
+        currLen = write( mSettings->mSock, mBuf, len ); 
+        if ( currLen < 0 && errno != ENOBUFS ) {
+            WARN_errno( currLen < 0, "write2" ); 
+            break; 
+        }
+
+        // report packets 
+        reportstruct->packetLen = currLen;
+        ReportPacket( mSettings->reporthdr, reportstruct );
+
+        if ( !mMode_Time ) {
+            mSettings->mAmount -= len;
+        }
+    }
+
+    // stop timing
+    gettime_monotonic( &(reportstruct->packetTime) );
+    Finish( reportstruct );
+
+    DELETE_PTR( reportstruct );
+    EndReport( mSettings->reporthdr );
+}
+// end RunTrace
+
+/* ------------------------------------------------------------------- 
+ * Return the next --zerocopy pool buffer, first waiting for the
+ * kernel to release the pages of the last send made from it.
+ * ------------------------------------------------------------------- */ 
+
+char* Client::ZeroCopyBuffer( void ) {
+    int i = mZCNext;
+
+    mZCNext = (mZCNext + 1) % kZeroCopy_Buffers;
+    ZeroCopyReap( false );
+    while ( mZCPoolSeq[i] > mZCDone && !sInterupted ) {
+        u_int32_t done = mZCDone;
+        ZeroCopyReap( true );
+        if ( mZCDone == done ) {
+            // no completion in kZeroCopy_Wait, stop waiting on it
+            mZCDone = mZCPoolSeq[i];
+        }
+    }
+    mZCPoolSeq[i] = mZCSent + 1;
+    return mZCPool[i];
+}
+
+/* ------------------------------------------------------------------- 
+ * Read MSG_ZEROCOPY completions from the socket error queue. Each
+ * notification covers a range of sends and says whether the kernel
+ * had to copy them after all, e.g. over loopback. If wait is set,
+ * block up to kZeroCopy_Wait for one to arrive.
+ * ------------------------------------------------------------------- */ 
+
+void Client::ZeroCopyReap( bool wait ) {
+#ifdef HAVE_MSG_ZEROCOPY
+    char control[128];
+    struct msghdr msg;
+    struct cmsghdr *cmsg;
+    struct sock_extended_err *serr;
+
+    if ( wait ) {
+        // a pending error queue is reported as POLLERR
+        struct pollfd pfd;
+        pfd.fd = mSettings->mSock;
+        pfd.events = 0;
+        pfd.revents = 0;
+        if ( poll( &pfd, 1, kZeroCopy_Wait ) <= 0 ) {
+            return;
+        }
+    }
+    for ( ;; ) {
+        memset( &msg, 0, sizeof(msg) );
+        msg.msg_control = control;
+        msg.msg_controllen = sizeof(control);
+        if ( recvmsg( mSettings->mSock, &msg, MSG_ERRQUEUE | MSG_DONTWAIT ) < 0 ) {
+            return;
+        }
+        for ( cmsg = CMSG_FIRSTHDR( &msg ); cmsg != NULL; 
+              cmsg = CMSG_NXTHDR( &msg, cmsg ) ) {
+            if ( !(cmsg->cmsg_level == SOL_IP && cmsg->cmsg_type == IP_RECVERR) &&
+                 !(cmsg->cmsg_level == SOL_IPV6 && cmsg->cmsg_type == IPV6_RECVERR) ) {
+                continue;
+            }
+            serr = (struct sock_extended_err*) CMSG_DATA( cmsg );
+            if ( serr->ee_errno != 0 || serr->ee_origin != SO_EE_ORIGIN_ZEROCOPY ) {
+                continue;
+            }
+            // sends ee_info through ee_data completed
+            if ( serr->ee_code & SO_EE_CODE_ZEROCOPY_COPIED ) {
+                mZCCopied += serr->ee_data - serr->ee_info + 1;
+            } else {
+                mZCZeroCopy += serr->ee_data - serr->ee_info + 1;
+            }
+            if ( serr->ee_data + 1 > mZCDone ) {
+                mZCDone = serr->ee_data + 1;
+            }
+        }
+    }
+#endif
+}
+
+/* ------------------------------------------------------------------- 
+ * --tx-timestamps. The kernel numbers the datagrams sent from 0 and
+ * stamps each on the wall clock as it leaves the socket layer. The
+ * wall clock is read just before each write, into a slot picked by
+ * its number, and the stamps are read from the socket error queue
+ * after each write. A stamp whose slot was reused is dropped. The
+ * delays wait in a queue to ride on the next reported datagrams, so
+ * the reporter sees one delay per datagram in the order stamped.
+ * ------------------------------------------------------------------- */ 
+
+void Client::TxStampStart( void ) {
+    if ( KernelStamp_EnableTX( mSettings->mSock ) != 0 ) {
+        fprintf( stderr, warn_txstamps_unsupported, strerror( errno ) );
+        mSettings->mTxStamps = 0;
+        return;
+    }
+    mTxSent = new struct timespec[ kTxStamp_Slots ];
+    mTxDelays = new double[ kTxStamp_Slots ];
+    mTxNext = 0;
+}
+
+void Client::TxStampWrite( void ) {
+    struct timespec *sent = &mTxSent[ mTxNext % kTxStamp_Slots ];
+#ifdef HAVE_CLOCK_GETTIME
+    clock_gettime( CLOCK_REALTIME, sent );
+#else
+    struct timeval now;
+    gettimeofday( &now, NULL );
+    sent->tv_sec = now.tv_sec;
+    sent->tv_nsec = now.tv_usec * 1000;
+#endif
+}
+
+void Client::TxStampReap( void ) {
+    u_int32_t key;
+    struct timespec stamp;
+
+    while ( KernelStamp_TX( mSettings->mSock, &key, &stamp ) ) {
+        struct timespec *sent = &mTxSent[ key % kTxStamp_Slots ];
+        double delay;
+        u_int32_t age = mTxNext - key;
+        if ( age == 0 || age > (u_int32_t) kTxStamp_Slots || 
+             mTxCount == kTxStamp_Slots ) {
+            continue;
+        }
+        delay = (stamp.tv_sec - sent->tv_sec) + 
+                (stamp.tv_nsec - sent->tv_nsec) / 1e9;
+        mTxDelays[ (mTxHead + mTxCount) % kTxStamp_Slots ] = (delay < 0 ? 0 : delay);
+        mTxCount++;
+    }
+}
+
+double Client::TxStampDelay( void ) {
+    double delay = -1;
+    if ( mTxCount > 0 ) {
+        delay = mTxDelays[ mTxHead ];
+        mTxHead = (mTxHead + 1) % kTxStamp_Slots;
+        mTxCount--;
+    }
+    return delay;
+}
+
+/* ------------------------------------------------------------------- 
+ * Copy the -b pacing statistics into the report so the final
+ * report shows how well deadlines were kept and at what CPU cost.
+ * ------------------------------------------------------------------- */ 
+
+void Client::PacingReport( void ) {
+    if ( mSettings->reporthdr != NULL && mDelay.count > 0 ) {
+        Transfer_Info *info = &mSettings->reporthdr->report.info;
+        info->cntDelays = mDelay.count;
+        info->delayLate = mDelay.late;
+        info->delayLateMax = mDelay.late_max;
+        info->cpuTime = (mCPUStart < 0 ? -1 : delay_cputime() - mCPUStart);
+    }
+}
+
+/* ------------------------------------------------------------------- 
+ * Send UDP datagrams mBatchSize at a time. Each datagram in the batch
+ * gets its own slot in mBuf, its own datagram ID and timestamp, and
+ * is reported individually. The batch is handed to the kernel with a
+ * single sendmmsg() where available, or as one UDP_SEGMENT write
+ * for the kernel to split when --udp-gso is set. The pacer is
+ * charged for a whole batch before it is built.
+ * ------------------------------------------------------------------- */ 
+
+void Client::RunUDPBatch( void ) {
+    int batch = mSettings->mBatchSize;
+    int hdrLen = 0;
+    long delay = 0; 
+    int count = 0;
+    int sent = 0;
+    int i;
+
+    // Indicates if the stream is readable 
+    bool canRead = true, mMode_Time = isModeTime( mSettings ); 
+
+    // setup termination variables
+    if ( mMode_Time ) {
+        mEndTime.setnow();
+        mEndTime.add( mSettings->mAmount / 100.0 );
+    }
+
+    // bandwidth restriction, paced one batch at a time
+    // unless the kernel is pacing the socket (--fq-rate)
+    TokenBucket pacer( (mSettings->mFQPacingRate > 0 ? 0 : mSettings->mUDPRate),
+                       mSettings->mBurstSize, batch * mSettings->mBufLen );
+    // --gap-dist spreads the same mean rate over random gaps
+    Distribution gaps( mSettings->mGapDist, mSettings->mGapShape, mSettings->mSeed );
+
+    if ( isFileInput( mSettings ) ) {
+        if ( isCompat( mSettings ) ) {
+            hdrLen = sizeof(struct UDP_datagram);
+        } else {
+            hdrLen = sizeof(struct UDP_datagram) + sizeof(struct client_hdr);
+        }
+        Extractor_reduceReadSize( hdrLen, mSettings );
+    }
+
+    // every slot carries the headers InitiateServer wrote into the first
+    for ( i = 1; i < batch; i++ ) {
+        memcpy( mBuf + i * mSettings->mBufLen, mBuf, mSettings->mBufLen );
+    }
+
+    struct timespec *packetTimes = new struct timespec[ batch ];
+    int *packetLens = new int[ batch ];
+#ifdef HAVE_SENDMMSG
+    struct mmsghdr *msgs = new struct mmsghdr[ batch ];
+    struct iovec *iov = new struct iovec[ batch ];
+    memset( msgs, 0, batch * sizeof(struct mmsghdr) );
+    for ( i = 0; i < batch; i++ ) {
+        iov[i].iov_base = mBuf + i * mSettings->mBufLen;
+        iov[i].iov_len  = mSettings->mBufLen;
+        msgs[i].msg_hdr.msg_iov    = &iov[i];
+        msgs[i].msg_hdr.msg_iovlen = 1;
+    }
+#endif
+
+    ReportStruct *reportstruct = NULL;
+
+    mSettings->reporthdr = InitReport( mSettings );
+    mCPUStart = delay_cputime();
+    reportstruct = new ReportStruct;
+    reportstruct->packetID = 0;
+
+    do {
+        int firstID = reportstruct->packetID;
+
+        // wait until the bucket holds enough tokens for a full batch 
+        delay = pacer.consume( batch * mSettings->mBufLen * gaps.next() ); 
+        if ( delay > 0 ) {
+            delay_loop_stats( delay, &mDelay ); 
+        }
+
+        // fill the batch, each datagram with its own ID and timestamp
+        for ( count = 0; count < batch && canRead; count++ ) {
+            char *slot = mBuf + count * mSettings->mBufLen;
+            struct UDP_datagram* mBuf_UDP = (struct UDP_datagram*) slot; 
+
+            gettime_monotonic( &packetTimes[count] );
+            gettimeofday( &(reportstruct->sentTime), NULL );
+            mBuf_UDP->id      = htonl( (reportstruct->packetID)++ ); 
+            mBuf_UDP->tv_sec  = htonl( reportstruct->sentTime.tv_sec ); 
+            mBuf_UDP->tv_usec = htonl( reportstruct->sentTime.tv_usec );
+
+            // Read the next data block from 
+            // the file if it's file input 
+            if ( isFileInput( mSettings ) ) {
+                Extractor_getNextDataBlock( slot + hdrLen, mSettings ); 
+                canRead = Extractor_canRead( mSettings ) != 0; 
+            }
+
+            if ( !mMode_Time && 
+                 (max_size_t) (count + 1) * mSettings->mBufLen >= mSettings->mAmount ) {
+                count++;
+                break;
+            }
+        }
+
+        // perform the writes, a short count means the socket was full
+        for ( i = 0; i < count; i++ ) {
+            packetLens[i] = 0;
+        }
+        sent = 0;
+        if ( isUDPGSO( mSettings ) ) {
+            // one write, which the kernel splits into count datagrams
+            int rc = write( mSettings->mSock, mBuf, count * mSettings->mBufLen );
+            if ( rc >= 0 ) {
+                for ( ; sent < count; sent++ ) {
+                    packetLens[sent] = mSettings->mBufLen;
+                }
+            } else if ( errno == EIO || errno == EINVAL || errno == ENOPROTOOPT ) {
+                // the device cannot segment, fall back to sending
+                // this and later batches as individual datagrams
+                fprintf( stderr, warn_gso_unsupported, strerror( errno ) );
+                unsetUDPGSO( mSettings );
+#ifdef UDP_SEGMENT
+                int gso = 0;
+                setsockopt( mSettings->mSock, IPPROTO_UDP, UDP_SEGMENT,
+                            (char*) &gso, sizeof(gso) );
+#endif
+            }
+        }
+        if ( !isUDPGSO( mSettings ) ) {
+#ifdef HAVE_SENDMMSG
+            while ( sent < count ) {
+                int rc = sendmmsg( mSettings->mSock, msgs + sent, count - sent, 0 );
+                if ( rc < 0 ) {
+                    break;
+                }
+                for ( i = sent; i < sent + rc; i++ ) {
+                    packetLens[i] = msgs[i].msg_len;
+                }
+                sent += rc;
+            }
+#else
+            for ( ; sent < count; sent++ ) {
+                int rc = write( mSettings->mSock, mBuf + sent * mSettings->mBufLen,
+                                mSettings->mBufLen );
+                if ( rc < 0 ) {
+                    break;
+                }
+                packetLens[sent] = rc;
+            }
+#endif
+        }
+        if ( sent < count && errno != ENOBUFS ) {
+            WARN_errno( 1, "write2" ); 
+            count = sent;
+            canRead = false;
+        }
+
+        // report packets, unsent datagrams count as lost
+        for ( i = 0; i < count; i++ ) {
+            reportstruct->packetID = firstID + i + 1;
+            reportstruct->packetTime = packetTimes[i];
+            reportstruct->packetLen = packetLens[i];
+            ReportPacket( mSettings->reporthdr, reportstruct );
+        }
+        
+        if ( !mMode_Time ) {
+            mSettings->mAmount -= (max_size_t) count * mSettings->mBufLen;
+        }
+
+    } while ( ! (sInterupted  || 
+                 (mMode_Time   &&  mEndTime.before( reportstruct->packetTime ))  || 
+                 (!mMode_Time  &&  0 >= (int64_t) mSettings->mAmount)) && canRead ); 
+
+    // stop timing
+    gettime_monotonic( &(reportstruct->packetTime) );
+    Finish( reportstruct );
+
+#ifdef HAVE_SENDMMSG
+    DELETE_ARRAY( msgs );
+    DELETE_ARRAY( iov );
+#endif
+    DELETE_ARRAY( packetTimes );
+    DELETE_ARRAY( packetLens );
+    DELETE_PTR( reportstruct );
+    EndReport( mSettings->reporthdr );
+} 
+// end RunUDPBatch
+
+/* ------------------------------------------------------------------- 
+ * Send with --io-uring. Writes are queued kIOUring_Slots at a time
+ * from slots of one buffer, as a linked chain so the kernel sends
+ * them in order, and the whole chain is submitted with one system
+ * call. The next chain is built when the last one completes.
+ * Datagrams are stamped as their slot is filled, written from the
+ * slots registered with the ring and reported as they complete. The
+ * pacer is charged per write.
+ * ------------------------------------------------------------------- */ 
+
+void Client::RunURing( void ) {
+#ifdef HAVE_IO_URING
+    IOUring ring;
+    long delay = 0; 
+    Timestamp due;                  // when a write held for the pacer may go
+    max_size_t totLen = 0;
+    int nextID = 0;
+    int pendingLen = 0;
+    int i;
+
+    if ( !IOUring_Initialize( &ring, kIOUring_Slots ) ) {
+        fprintf( stderr, warn_iouring_unsupported, strerror( errno ) );
+        unsetIOUring( mSettings );
+        Run();
+        return;
+    }
+
+    // every slot starts as a copy of mBuf, with the headers
+    // InitiateServer wrote and room for the largest write
+    int slotSize = mSettings->mBufLen;
+    for ( i = 0; i < mSettings->mSizeCount; i++ ) {
+        if ( slotSize < mSettings->mSizes[i] ) {
+            slotSize = mSettings->mSizes[i];
+        }
+    }
+    char *slots = BufferPool_Get( kIOUring_Slots * slotSize );
+    for ( i = 0; i < kIOUring_Slots; i++ ) {
+        memcpy( slots + i * slotSize, mBuf, slotSize );
+    }
+    bool udp = isUDP( mSettings ), mMode_Time = isModeTime( mSettings ); 
+
+    // datagrams are written from the slots pinned as a registered
+    // buffer, without locked memory to pin them plain writes still
+    // work, TCP sends have no fixed buffer form
+    bool fixed = udp && IOUring_RegisterBuffer( &ring, slots, kIOUring_Slots * slotSize );
+
+    struct timespec *packetTimes = new struct timespec[ kIOUring_Slots ];
+    int *packetIDs = new int[ kIOUring_Slots ];
+
+    bool periodicReport = (mSettings->mInterval > 0);
+    bool done = false;
+
+    if ( mMode_Time ) {
+        mEndTime.setnow();
+        mEndTime.add( mSettings->mAmount / 100.0 );
+    }
+
+    TokenBucket pacer( (mSettings->mFQPacingRate > 0 ? 0 : mSettings->mUDPRate),
+                       mSettings->mBurstSize, mSettings->mBufLen );
+    Distribution gaps( mSettings->mGapDist, mSettings->mGapShape, mSettings->mSeed );
+    SizeMix mix( mSettings, (!udp ? 1 : 
+                             isCompat( mSettings ) ? sizeof(struct UDP_datagram) :
+                             sizeof(struct UDP_datagram) + sizeof(struct client_hdr)) );
+
+    ReportStruct *reportstruct = NULL;
+
+    mSettings->reporthdr = InitReport( mSettings );
+    mCPUStart = delay_cputime();
+    reportstruct = new ReportStruct;
+    reportstruct->packetID = 0;
+
+    lastPacketTime.setnow();
+
+    while ( !done ) {
+        struct io_uring_sqe *sqe = NULL;
+        max_size_t queued = 0;
+        int count = 0;
+
+        // build the chain
+        while ( count < kIOUring_Slots ) {
+            int writeLen = pendingLen;
+
+            if ( writeLen == 0 ) {
+                gettime_monotonic( &(reportstruct->packetTime) );
+                if ( sInterupted || 
+                     (mMode_Time && mEndTime.before( reportstruct->packetTime )) ||
+                     (!mMode_Time && (int64_t) mSettings->mAmount <= (int64_t) queued) ) {
+                    done = true;
+                    break;
+                }
+                writeLen = ( mix.active() ? mix.next() : mSettings->mBufLen );
+                delay = pacer.consume( writeLen * (udp ? gaps.next() : 1) ); 
+                if ( delay > 0 && count > 0 ) {
+                    // send what is queued before waiting on the pacer,
+                    // the time the chain takes counts toward the wait
+                    due.setnow();
+                    due.add( delay / 1e6 );
+                    pendingLen = writeLen;
+                    break;
+                }
+            } else if ( delay > 0 ) {
+                // held over from the last chain, wait what is left
+                Timestamp now;
+                delay = due.subUsec( now );
+            }
+            pendingLen = 0;
+            if ( delay > 0 ) {
+                delay_loop_stats( delay, &mDelay ); 
+                delay = 0;
+            }
+
+            char *slot = slots + count * slotSize;
+            gettime_monotonic( &packetTimes[count] );
+            if ( udp ) {
+                // store datagram ID and wall clock send time into the slot
+                struct UDP_datagram* mBuf_UDP = (struct UDP_datagram*) slot; 
+                gettimeofday( &(reportstruct->sentTime), NULL );
+                packetIDs[count] = nextID;
+                mBuf_UDP->id      = htonl( nextID++ ); 
+                mBuf_UDP->tv_sec  = htonl( reportstruct->sentTime.tv_sec ); 
+                mBuf_UDP->tv_usec = htonl( reportstruct->sentTime.tv_usec );
+            }
+
+            sqe = IOUring_getSQE( &ring );
+            sqe->fd = mSettings->mSock;
+            sqe->addr = (unsigned long) slot;
+            sqe->len = writeLen;
+            if ( udp ) {
+                // a datagram goes whole or not at all
+                sqe->opcode = ( fixed ? IORING_OP_WRITE_FIXED : IORING_OP_WRITE );
+                sqe->buf_index = 0;
+            } else {
+                // a send that waits for all of its bytes, so a short
+                // one does not break the chain
+                sqe->opcode = IORING_OP_SEND;
+                sqe->msg_flags = MSG_WAITALL;
+            }
+            sqe->flags = IOSQE_IO_LINK;
+            sqe->user_data = count;
+            queued += writeLen;
+            count++;
+        }
+        if ( count == 0 ) {
+            break;
+        }
+        // the chain ends at its last write
+        sqe->flags &= ~IOSQE_IO_LINK;
+
+        // submit it and collect all of its completions
+        int reaped = 0;
+        int rc = IOUring_Submit( &ring, count );
+        while ( reaped < count ) {
+            struct io_uring_cqe *cqe;
+            while ( (cqe = IOUring_peekCQE( &ring )) != NULL ) {
+                int slot = (int) cqe->user_data;
+                int res = cqe->res;
+                IOUring_seenCQE( &ring );
+                reaped++;
+
+                if ( res < 0 ) {
+                    // a write cancelled behind a failed one, or a full
+                    // device queue, counts as unsent like in Run
+                    if ( res != -ECANCELED && res != -ENOBUFS && res != -EAGAIN ) {
+                        errno = -res;
+                        WARN_errno( 1, "write2" ); 
+                        done = true;
+                    }
+                    res = 0;
+                }
+                totLen += res;
+                mix.sent( res );
+                if ( udp ) {
+                    reportstruct->packetID = packetIDs[slot] + 1;
+                    reportstruct->packetTime = packetTimes[slot];
+                    reportstruct->packetLen = res;
+                    ReportPacket( mSettings->reporthdr, reportstruct );
+                } else if ( periodicReport ) {
+                    gettime_monotonic( &(reportstruct->packetTime) );
+                    reportstruct->packetLen = res;
+                    ReportPacket( mSettings->reporthdr, reportstruct );
+                }
+                if ( !mMode_Time ) {
+                    mSettings->mAmount -= res;
+                }
+            }
+            if ( reaped < count ) {
+                rc = IOUring_Submit( &ring, count - reaped );
+            }
+            if ( rc < 0 && rc != -EINTR && rc != -EAGAIN && rc != -EBUSY ) {
+                errno = -rc;
+                WARN_errno( 1, "io_uring_enter" );
+                done = true;
+                break;
+            }
+        }
+    }
+    // also cancels any writes left in flight
+    IOUring_Destroy( &ring );
+
+    // stop timing
+    gettime_monotonic( &(reportstruct->packetTime) );
+    reportstruct->packetID = nextID;
+
+    // if we're not doing interval reporting, report the entire transfer as one big packet
+    if ( !udp && 0.0 == mSettings->mInterval ) {
+        reportstruct->packetLen = totLen;
+        ReportPacket( mSettings->reporthdr, reportstruct );
+    }
+    if ( mix.active() && mSettings->reporthdr != NULL ) {
+        mix.report( &mSettings->reporthdr->report.info );
+    }
+    Finish( reportstruct );
+
+    BufferPool_Put( slots );
+    DELETE_ARRAY( packetTimes );
+    DELETE_ARRAY( packetIDs );
+    DELETE_PTR( reportstruct );
+    EndReport( mSettings->reporthdr );
+#else
+    unsetIOUring( mSettings );
+    Run();
+#endif
+} 
+// end RunURing
+
+/* ------------------------------------------------------------------- 
+ * Stream interface for ClientEngine. Instead of looping in Run, the
+ * stream sends one write per StreamWrite on a non-blocking socket and
+ * reports the same way Run and RunTCP do, so the per stream and sum
+ * reports are unchanged.
+ * ------------------------------------------------------------------- */ 
+
+void Client::StreamStart( void ) {
+    // InitReport skips the barrier, the worker has waited at it
+    mSettings->reporthdr = InitReport( mSettings );
+    mStreamReport = new ReportStruct;
+    mStreamReport->packetID = 0;
+    mStreamTotal = 0;
+
+    if ( isModeTime( mSettings ) ) {
+        mEndTime.setnow();
+        mEndTime.add( mSettings->mAmount / 100.0 );
+    }
+    lastPacketTime.setnow();
+
+#ifdef HAVE_SYS_EPOLL_H
+    // the worker waits on all of its sockets, none of them may block
+    int flags = fcntl( mSettings->mSock, F_GETFL, 0 );
+    fcntl( mSettings->mSock, F_SETFL, flags | O_NONBLOCK );
+#endif
+}
+
+long Client::StreamWrite( int len ) {
+    struct UDP_datagram* mBuf_UDP = (struct UDP_datagram*) mBuf; 
+    long currLen;
 
     if ( isUDP( mSettings ) ) {
-        // send a final terminating datagram 
-        // Don't count in the mTotalLen. The server counts this one, 
-        // but didn't count our first datagram, so we're even now. 
-        // The negative datagram ID signifies termination to the server. 
-    
-        // store datagram ID into buffer 
-        mBuf_UDP->id      = htonl( -(reportstruct->packetID)  ); 
-        mBuf_UDP->tv_sec  = htonl( reportstruct->packetTime.tv_sec ); 
-        mBuf_UDP->tv_usec = htonl( reportstruct->packetTime.tv_usec ); 
+        // the ID is only used up once the datagram is sent
+        gettimeofday( &(mStreamReport->sentTime), NULL );
+        mBuf_UDP->id      = htonl( mStreamReport->packetID ); 
+        mBuf_UDP->tv_sec  = htonl( mStreamReport->sentTime.tv_sec ); 
+        mBuf_UDP->tv_usec = htonl( mStreamReport->sentTime.tv_usec );
+        if ( mSettings->mVerify && len >= (int) (sizeof(UDP_datagram) + sizeof(u_int32_t)) ) {
+            Verify_FillDatagram( mBuf, len, sizeof(UDP_datagram) + sizeof(client_hdr),
+                                 mStreamReport->packetID );
+        }
+    } else if ( mSettings->mVerify ) {
+        Verify_FillStream( mBuf, len, mStreamTotal );
+    }
+    currLen = write( mSettings->mSock, mBuf, len ); 
+    if ( currLen < 0 ) {
+        return currLen;
+    }
+    gettime_monotonic( &(mStreamReport->packetTime) );
+    if ( isUDP( mSettings ) ) {
+        mStreamReport->packetID++;
+    }
+
+    // TCP only reports each write for interval reports, like RunTCP
+    if ( isUDP( mSettings ) || mSettings->mInterval > 0 ) {
+        mStreamReport->packetLen = currLen;
+        ReportPacket( mSettings->reporthdr, mStreamReport );
+    }
+    mStreamTotal += currLen;
+    if ( !isModeTime( mSettings ) ) {
+        mSettings->mAmount -= currLen;
+    }
+    return currLen;
+}
+
+bool Client::StreamDone( void ) {
+    if ( sInterupted ) {
+        return true;
+    }
+    if ( isModeTime( mSettings ) ) {
+        Timestamp now;
+        return mEndTime.before( now );
+    }
+    return 0 >= (int64_t) mSettings->mAmount;
+}
 
+/* ------------------------------------------------------------------- 
+ * A UDP stream's FIN is not waited on here, the worker must keep its
+ * other streams going. StreamEnd returns false and leaves the FIN in
+ * mBuf; the worker then calls StreamFIN to send it and every time a
+ * retry is due or the socket turns readable, until it returns true.
+ * ------------------------------------------------------------------- */ 
+
+bool Client::StreamEnd( void ) {
+    // stop timing
+    gettime_monotonic( &(mStreamReport->packetTime) );
+    if ( !isUDP( mSettings ) && mSettings->mInterval == 0.0 ) {
+        // report the entire transfer as one big packet
+        mStreamReport->packetLen = mStreamTotal;
+        ReportPacket( mSettings->reporthdr, mStreamReport );
+    }
+    CloseReport( mSettings->reporthdr, mStreamReport );
+
+    if ( isUDP( mSettings ) ) {
+        StampFIN( mStreamReport );
         if ( isMulticast( mSettings ) ) {
             write( mSettings->mSock, mBuf, mSettings->mBufLen ); 
         } else {
-            write_UDP_FIN( ); 
+            mStreamFINs = 0;
+            return false;
         }
     }
-    DELETE_PTR( reportstruct );
+    StreamClose();
+    return true;
+}
+
+/* ------------------------------------------------------------------- 
+ * The non-blocking version of write_UDP_FIN: read the server's reply
+ * if readable, else send the FIN again, at most kFIN_Tries times.
+ * ------------------------------------------------------------------- */ 
+
+bool Client::StreamFIN( bool readable ) {
+    if ( readable ) {
+        int rc = read( mSettings->mSock, mBuf, mSettings->mBufLen ); 
+        if ( rc < 0 && (errno == EAGAIN || errno == EWOULDBLOCK) ) {
+            return false;
+        }
+        if ( rc < 0 ) {
+            WARN_errno( rc < 0, "read" );
+        } else if ( rc >= (int) (sizeof(UDP_datagram) + sizeof(server_hdr)) ) {
+            ReportServerUDP( mSettings, (server_hdr*) ((UDP_datagram*)mBuf + 1) );
+        }
+        StreamClose();
+        return true;
+    }
+    if ( mStreamFINs >= kFIN_Tries ) {
+        fprintf( stderr, warn_no_ack, mSettings->mSock, mStreamFINs ); 
+        StreamClose();
+        return true;
+    }
+    mStreamFINs++;
+    write( mSettings->mSock, mBuf, mSettings->mBufLen ); 
+    return false;
+}
+
+void Client::StreamClose( void ) {
+    if ( mStreamReport == NULL ) {
+        return;
+    }
+    DELETE_PTR( mStreamReport );
     EndReport( mSettings->reporthdr );
-} 
-// end Run
+}
 
 void Client::InitiateServer() {
     if ( !isCompat( mSettings ) ) {
@@ -417,6 +1619,42 @@ void Client::Connect( ) {
                  &mSettings->size_peer );
 } // end Connect
 
+/* ------------------------------------------------------------------- 
+ * The common end of the Run variants: close the report and, for UDP,
+ * send a final terminating datagram. Don't count it in the mTotalLen.
+ * The server counts this one, but didn't count our first datagram,
+ * so we're even now. The negative datagram ID signifies termination
+ * to the server.
+ * ------------------------------------------------------------------- */ 
+
+void Client::Finish( ReportStruct *reportstruct ) {
+    PacingReport();
+    CloseReport( mSettings->reporthdr, reportstruct );
+
+    if ( isUDP( mSettings ) ) {
+        StampFIN( reportstruct );
+        if ( isMulticast( mSettings ) ) {
+            write( mSettings->mSock, mBuf, mSettings->mBufLen ); 
+        } else {
+            write_UDP_FIN( ); 
+        }
+    }
+}
+
+/* ------------------------------------------------------------------- 
+ * Store the negative datagram ID and the time into mBuf, making it
+ * the FIN.
+ * ------------------------------------------------------------------- */ 
+
+void Client::StampFIN( ReportStruct *reportstruct ) {
+    struct UDP_datagram* mBuf_UDP = (struct UDP_datagram*) mBuf; 
+
+    gettimeofday( &(reportstruct->sentTime), NULL );
+    mBuf_UDP->id      = htonl( -(reportstruct->packetID)  ); 
+    mBuf_UDP->tv_sec  = htonl( reportstruct->sentTime.tv_sec ); 
+    mBuf_UDP->tv_usec = htonl( reportstruct->sentTime.tv_usec ); 
+}
+
 /* ------------------------------------------------------------------- 
  * Send a datagram on the socket. The datagram's contents should signify 
  * a FIN to the application. Keep re-transmitting until an 
@@ -0,0 +1,390 @@
+/*--------------------------------------------------------------- 
+ * Copyright (c) 1999,2000,2001,2002,2003                       
+ * The Board of Trustees of the University of Illinois            
+ * All Rights Reserved.                                           
+ *--------------------------------------------------------------- 
+ * Permission is hereby granted, free of charge, to any person    
+ * obtaining a copy of this software (Iperf) and associated       
+ * documentation files (the "Software"), to deal in the Software  
+ * without restriction, including without limitation the          
+ * rights to use, copy, modify, merge, publish, distribute,        
+ * sublicense, and/or sell copies of the Software, and to permit     
+ * persons to whom the Software is furnished to do
+ * so, subject to the following conditions: 
+ *
+ *     
+ * Redistributions of source code must retain the above 
+ * copyright notice, this list of conditions and 
+ * the following disclaimers. 
+ *
+ *     
+ * Redistributions in binary form must reproduce the above 
+ * copyright notice, this list of conditions and the following 
+ * disclaimers in the documentation and/or other materials 
+ * provided with the distribution. 
+ * 
+ *     
+ * Neither the names of the University of Illinois, NCSA, 
+ * nor the names of its contributors may be used to endorse 
+ * or promote products derived from this Software without
+ * specific prior written permission. 
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, 
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES 
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND 
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE CONTIBUTORS OR COPYRIGHT 
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, 
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, 
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE. 
+ * ________________________________________________________________
+ * National Laboratory for Applied Network Research 
+ * National Center for Supercomputing Applications 
+ * University of Illinois at Urbana-Champaign 
+ * http://www.ncsa.uiuc.edu
+ * ________________________________________________________________ 
+ *
+ * ClientEngine.cpp
+ * -------------------------------------------------------------------
+ * Runs a --workers thread's streams from one epoll loop. Each stream
+ * is a Client driven through its Stream* calls, so it connects,
+ * reports and ends the test exactly as a stream with its own thread.
+ * ------------------------------------------------------------------- */
+
+#include "headers.h"
+#include "ClientEngine.hpp"
+#include "Reporter.h"
+#include "util.h"
+#include "Locale.h"
+
+#ifdef HAVE_SYS_EPOLL_H
+
+/* -------------------------------------------------------------------
+ * Send modes that loop over a whole batch, frame or file on their
+ * own are not split into single writes; those streams use plain
+ * writes of -l bytes (or --size-mix) instead.
+ * ------------------------------------------------------------------- */
+
+ClientEngine::ClientEngine( thread_Settings *inSettings ) {
+    mSettings = inSettings;
+    mCount = mSettings->mWorkerStreams;
+    mActive = 0;
+    mTimerCount = 0;
+
+    if ( isIsochronous( mSettings ) || isTrace( mSettings ) || 
+         isZeroCopy( mSettings ) || isFileInput( mSettings ) || 
+         isSendFile( mSettings ) || isUDPGSO( mSettings ) || 
+         mSettings->mBatchSize > 1 ) {
+        if ( isReport( mSettings ) ) {
+            fprintf( stderr, warn_workers_options );
+        }
+        unsetIsochronous( mSettings );
+        unsetTrace( mSettings );
+        unsetZeroCopy( mSettings );
+        unsetFileInput( mSettings );
+        unsetSendFile( mSettings );
+        unsetUDPGSO( mSettings );
+        mSettings->mBatchSize = 1;
+    }
+
+    mEpoll = epoll_create( mCount > 0 ? mCount : 1 );
+    FAIL_errno( mEpoll < 0, "epoll_create", mSettings );
+
+    mStreams = new Stream[ mCount ];
+    // a closing stream may still have its pacer's timer queued
+    mTimers = new Timer[ 2 * mCount ];
+
+    int minLen = ( !isUDP( mSettings ) ? 1 : 
+                   isCompat( mSettings ) ? sizeof(struct UDP_datagram) :
+                   sizeof(struct UDP_datagram) + sizeof(struct client_hdr) );
+
+    for ( int i = 0; i < mCount; i++ ) {
+        Stream *stream = &mStreams[i];
+
+        // each stream has its own settings, socket and report and
+        // draws its gaps from its own seed, as with one thread each
+        Settings_Copy( mSettings, &stream->settings );
+        stream->settings->mWorkerStreams = 0;
+        stream->settings->mSeed = mSettings->mSeed + i;
+        setWorker( stream->settings );
+        if ( i > 0 ) {
+            unsetReport( stream->settings );
+        }
+
+        stream->client = new Client( stream->settings );
+        stream->client->InitiateServer();
+
+        stream->pacer = new TokenBucket( (mSettings->mFQPacingRate > 0 ? 0 : 
+                                          mSettings->mUDPRate),
+                                         mSettings->mBurstSize, mSettings->mBufLen );
+        stream->gaps = new Distribution( mSettings->mGapDist, mSettings->mGapShape, 
+                                         stream->settings->mSeed );
+        stream->mix = new SizeMix( stream->settings, minLen );
+        stream->pending = 0;
+        stream->armed = false;
+        stream->timed = false;
+        stream->closing = false;
+        mActive++;
+    }
+} // end ClientEngine
+
+ClientEngine::~ClientEngine() {
+    for ( int i = 0; i < mCount; i++ ) {
+        // a stream Run left waiting on its FIN ends without the ack
+        Finish( i );
+        if ( mStreams[i].client != NULL ) {
+            mStreams[i].client->StreamClose();
+            Release( i );
+        }
+    }
+    DELETE_ARRAY( mStreams );
+    DELETE_ARRAY( mTimers );
+    if ( mEpoll >= 0 ) {
+        close( mEpoll );
+    }
+} // end ~ClientEngine
+
+/* -------------------------------------------------------------------
+ * Start all streams at once, after the other threads of the test
+ * reach the barrier, then wait for sockets and timers until every
+ * stream has finished. Streams blocked on a full socket are checked
+ * for the end of the test every kSweep_Msecs.
+ * ------------------------------------------------------------------- */
+
+void ClientEngine::Run( void ) {
+    struct epoll_event events[ kMax_Events ];
+    Timestamp lastSweep;
+
+#ifdef HAVE_THREAD
+    if ( mSettings->multihdr != NULL ) {
+        BarrierStreams( mSettings->multihdr, mCount );
+    }
+#endif
+    for ( int i = 0; i < mCount; i++ ) {
+        struct epoll_event event;
+
+        mStreams[i].client->StreamStart();
+        memset( &event, 0, sizeof(event) );
+        event.events = EPOLLOUT;
+        event.data.u32 = i;
+        int rc = epoll_ctl( mEpoll, EPOLL_CTL_ADD, mStreams[i].settings->mSock, &event );
+        WARN_errno( rc < 0, "epoll_ctl" );
+        mStreams[i].armed = true;
+    }
+
+    while ( mActive > 0 ) {
+        int timeout = kSweep_Msecs;
+        Timestamp now;
+
+        // sleep no later than the first pacer deadline, rounded up
+        // to the ms epoll can wait; the token bucket makes up for it
+        if ( mTimerCount > 0 ) {
+            long usecs = mTimers[0].due.subUsec( now );
+            if ( usecs < 0 ) {
+                usecs = 0;
+            }
+            if ( usecs < timeout * 1000L ) {
+                timeout = (int) ((usecs + 999) / 1000);
+            }
+        }
+
+        int ready = epoll_wait( mEpoll, events, kMax_Events, timeout );
+        if ( ready < 0 ) {
+            if ( errno == EINTR ) {
+                continue;
+            }
+            WARN_errno( ready < 0, "epoll_wait" );
+            break;
+        }
+        for ( int k = 0; k < ready; k++ ) {
+            int index = events[k].data.u32;
+            if ( mStreams[index].closing ) {
+                Closing( index, true );
+            } else {
+                Service( index );
+            }
+        }
+
+        now.setnow();
+        while ( mTimerCount > 0 && !now.before( mTimers[0].due ) ) {
+            int index = mTimers[0].stream;
+            TimerPop();
+            if ( mStreams[index].closing ) {
+                Closing( index, false );
+            } else {
+                mStreams[index].timed = false;
+                Service( index );
+            }
+        }
+
+        if ( now.subUsec( lastSweep ) >= kSweep_Msecs * 1000L ) {
+            lastSweep = now;
+            for ( int i = 0; i < mCount; i++ ) {
+                if ( mStreams[i].client != NULL && mStreams[i].client->StreamDone() ) {
+                    Finish( i );
+                }
+            }
+        }
+    }
+} // end Run
+
+void ClientEngine::Service( int index ) {
+    Stream *stream = &mStreams[index];
+
+    for ( int budget = kWrite_Budget; budget > 0; budget-- ) {
+        if ( stream->client == NULL || stream->timed ) {
+            return;
+        }
+        if ( stream->client->StreamDone() ) {
+            Finish( index );
+            return;
+        }
+        if ( stream->pending == 0 ) {
+            int len = ( stream->mix->active() ? stream->mix->next() : 
+                        mSettings->mBufLen );
+            long delay = stream->pacer->consume( len * stream->gaps->next() );
+
+            stream->pending = len;
+            if ( delay > 0 ) {
+                // come back from the timer heap, not for EPOLLOUT
+                Timestamp due;
+                due.add( delay / 1e6 );
+                TimerPush( due, index );
+                Arm( index, false );
+                return;
+            }
+        }
+
+        long currLen = stream->client->StreamWrite( stream->pending );
+        if ( currLen < 0 ) {
+            if ( errno == EAGAIN || errno == EWOULDBLOCK || errno == ENOBUFS ) {
+                Arm( index, true );
+                return;
+            }
+            WARN_errno( currLen < 0, "write" );
+            Finish( index );
+            return;
+        }
+        stream->mix->sent( currLen );
+        stream->pending = 0;
+    }
+    // out of budget, let the other streams have a turn
+    Arm( index, true );
+} // end Service
+
+void ClientEngine::Arm( int index, bool on ) {
+    Stream *stream = &mStreams[index];
+    struct epoll_event event;
+
+    if ( stream->armed == on ) {
+        return;
+    }
+    memset( &event, 0, sizeof(event) );
+    event.events = ( on ? EPOLLOUT : 0 );
+    event.data.u32 = index;
+    int rc = epoll_ctl( mEpoll, EPOLL_CTL_MOD, stream->settings->mSock, &event );
+    WARN_errno( rc < 0, "epoll_ctl" );
+    stream->armed = on;
+}
+
+/* -------------------------------------------------------------------
+ * Timers of finished streams are left in the heap and skipped by
+ * Service when they come due. A UDP stream instead sends its FIN and
+ * waits, without blocking the others, for the server's report on
+ * EPOLLIN or for the timer heap to retry the FIN every kFIN_Msecs.
+ * ------------------------------------------------------------------- */
+
+void ClientEngine::Finish( int index ) {
+    Stream *stream = &mStreams[index];
+    struct epoll_event event;
+
+    if ( stream->client == NULL || stream->closing ) {
+        return;
+    }
+    if ( stream->client->StreamEnd() ) {
+        Release( index );
+        return;
+    }
+    memset( &event, 0, sizeof(event) );
+    event.events = EPOLLIN;
+    event.data.u32 = index;
+    int rc = epoll_ctl( mEpoll, EPOLL_CTL_MOD, stream->settings->mSock, &event );
+    WARN_errno( rc < 0, "epoll_ctl" );
+    stream->armed = false;
+    stream->closing = true;
+    stream->retry.setnow();
+    Closing( index, false );
+}
+
+void ClientEngine::Closing( int index, bool readable ) {
+    Stream *stream = &mStreams[index];
+
+    if ( stream->client == NULL ) {
+        return;
+    }
+    if ( !readable ) {
+        // skip a pacer timer queued before the FIN
+        Timestamp now;
+        if ( now.before( stream->retry ) ) {
+            return;
+        }
+    }
+    if ( stream->client->StreamFIN( readable ) ) {
+        Release( index );
+    } else if ( !readable ) {
+        stream->retry.setnow();
+        stream->retry.add( kFIN_Msecs / 1e3 );
+        TimerPush( stream->retry, index );
+    }
+}
+
+void ClientEngine::Release( int index ) {
+    Stream *stream = &mStreams[index];
+
+    if ( stream->settings->mSock != INVALID_SOCKET ) {
+        epoll_ctl( mEpoll, EPOLL_CTL_DEL, stream->settings->mSock, NULL );
+    }
+    DELETE_PTR( stream->client );
+    Settings_Destroy( stream->settings );
+    stream->settings = NULL;
+    DELETE_PTR( stream->pacer );
+    DELETE_PTR( stream->gaps );
+    DELETE_PTR( stream->mix );
+    mActive--;
+}
+
+void ClientEngine::TimerPush( Timestamp due, int index ) {
+    int i = mTimerCount++;
+
+    while ( i > 0 && due.before( mTimers[(i - 1) / 2].due ) ) {
+        mTimers[i] = mTimers[(i - 1) / 2];
+        i = (i - 1) / 2;
+    }
+    mTimers[i].due = due;
+    mTimers[i].stream = index;
+    mStreams[index].timed = true;
+}
+
+void ClientEngine::TimerPop( void ) {
+    Timer last = mTimers[--mTimerCount];
+    int i = 0;
+
+    for ( ;; ) {
+        int child = 2 * i + 1;
+        if ( child >= mTimerCount ) {
+            break;
+        }
+        if ( child + 1 < mTimerCount && 
+             mTimers[child + 1].due.before( mTimers[child].due ) ) {
+            child++;
+        }
+        if ( !mTimers[child].due.before( last.due ) ) {
+            break;
+        }
+        mTimers[i] = mTimers[child];
+        i = child;
+    }
+    mTimers[i] = last;
+}
+
+#endif // HAVE_SYS_EPOLL_H
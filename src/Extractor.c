@@ -63,6 +63,68 @@
 
 #include "Extractor.h"
 
+/*
+ * Amount of the mapped file to ask the kernel
+ * to read ahead of the current position
+ */
+#define EXTRACTOR_READAHEAD (4 * 1024 * 1024)
+
+/*
+ * Map the whole file into memory so blocks are served
+ * from the page cache without a read() per block. Files
+ * that cannot be mapped (pipes, empty files) stay on stdio.
+ */
+static void Extractor_mapFile ( thread_Settings *mSettings ) {
+#if defined(HAVE_MMAP) && defined(HAVE_SYS_MMAN_H)
+    struct stat st;
+    void *map;
+    int fd = fileno( mSettings->Extractor_file );
+
+    if ( fstat( fd, &st ) != 0 || !S_ISREG( st.st_mode ) || st.st_size <= 0 ) {
+        return;
+    }
+    map = mmap( NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0 );
+    if ( map == MAP_FAILED ) {
+        return;
+    }
+    mSettings->Extractor_map = (char*) map;
+    mSettings->Extractor_mapsize = st.st_size;
+#if defined(HAVE_MADVISE) && defined(MADV_SEQUENTIAL)
+    madvise( map, st.st_size, MADV_SEQUENTIAL );
+#endif
+#if defined(HAVE_MADVISE) && defined(MADV_WILLNEED)
+    madvise( map, (st.st_size < 2 * EXTRACTOR_READAHEAD ? 
+                   st.st_size : 2 * EXTRACTOR_READAHEAD), MADV_WILLNEED );
+#endif
+#endif
+}
+
+/*
+ * Move the position in the mapped file forward by len,
+ * wrapping at the end, and keep the read-ahead window
+ * one window in front of the new position
+ */
+static void Extractor_advance ( int len, thread_Settings *mSettings ) {
+    max_size_t from = mSettings->Extractor_offset;
+    max_size_t to = from + len;
+
+    if ( to >= mSettings->Extractor_mapsize && isFileLoop( mSettings ) ) {
+        to = 0;
+    }
+    mSettings->Extractor_offset = to;
+#if defined(HAVE_MADVISE) && defined(MADV_WILLNEED)
+    if ( to / EXTRACTOR_READAHEAD != from / EXTRACTOR_READAHEAD ) {
+        max_size_t start = (to / EXTRACTOR_READAHEAD + 1) * EXTRACTOR_READAHEAD;
+        if ( start < mSettings->Extractor_mapsize ) {
+            max_size_t size = mSettings->Extractor_mapsize - start;
+            if ( size > EXTRACTOR_READAHEAD ) {
+                size = EXTRACTOR_READAHEAD;
+            }
+            madvise( mSettings->Extractor_map + start, size, MADV_WILLNEED );
+        }
+    }
+#endif
+}
 
 /**
  * Constructor
@@ -72,12 +134,15 @@
  */
 void Extractor_Initialize ( char *fileName, int inSize, thread_Settings *mSettings ) {
 
+    mSettings->Extractor_map = NULL;
+    mSettings->Extractor_offset = 0;
     if ( (mSettings->Extractor_file = fopen (fileName, "rb")) == NULL ) {
         fprintf( stderr, "Unable to open the file stream\n");
         fprintf( stderr, "Will use the default data stream\n");
         return;
     }
     mSettings->Extractor_size =  inSize;
+    Extractor_mapFile( mSettings );
 }
 
 
@@ -88,8 +153,11 @@ void Extractor_Initialize ( char *fileName, int inSize, thread_Settings *mSettin
  * Set the block size,file pointer
  */
 void Extractor_InitializeFile ( FILE *fp, int inSize, thread_Settings *mSettings ) {
+    mSettings->Extractor_map = NULL;
+    mSettings->Extractor_offset = 0;
     mSettings->Extractor_file = fp;
     mSettings->Extractor_size =  inSize;
+    Extractor_mapFile( mSettings );
 }
 
 
@@ -97,35 +165,131 @@ void Extractor_InitializeFile ( FILE *fp, int inSize, thread_Settings *mSettings
  * Destructor - Close the file
  */
 void Extractor_Destroy ( thread_Settings *mSettings ) {
-    if ( mSettings->Extractor_file != NULL )
+#if defined(HAVE_MMAP) && defined(HAVE_SYS_MMAN_H)
+    if ( mSettings->Extractor_map != NULL ) {
+        munmap( mSettings->Extractor_map, mSettings->Extractor_mapsize );
+        mSettings->Extractor_map = NULL;
+    }
+#endif
+    if ( mSettings->Extractor_file != NULL ) {
         fclose( mSettings->Extractor_file );
+        mSettings->Extractor_file = NULL;
+    }
 }
 
 
 /*
  * Fetches the next data block from 
- * the file
+ * the file. With --file-loop the file is
+ * rewound at the end to fill the block
  * @arg block     Pointer to the data read
  * @return        Number of bytes read
  */
 int Extractor_getNextDataBlock ( char *data, thread_Settings *mSettings ) {
+    if ( mSettings->Extractor_map != NULL ) {
+        int len = 0;
+        while ( len < mSettings->Extractor_size && Extractor_canRead( mSettings ) ) {
+            int chunk;
+            char *from = Extractor_getNextDataPointer( &chunk, 
+                             mSettings->Extractor_size - len, mSettings );
+            memcpy( data + len, from, chunk );
+            len += chunk;
+        }
+        return len;
+    }
     if ( Extractor_canRead( mSettings ) ) {
-        return(fread( data, 1, mSettings->Extractor_size, 
-                      mSettings->Extractor_file ));
+        int len = fread( data, 1, mSettings->Extractor_size, 
+                         mSettings->Extractor_file );
+        while ( isFileLoop( mSettings ) && len < mSettings->Extractor_size
+                && feof( mSettings->Extractor_file ) ) {
+            int more;
+            if ( fseek( mSettings->Extractor_file, 0, SEEK_SET ) != 0 ) {
+                break;
+            }
+            more = fread( data + len, 1, mSettings->Extractor_size - len,
+                          mSettings->Extractor_file );
+            if ( more == 0 ) {
+                break;
+            }
+            len += more;
+        }
+        return len;
     }
     return 0;
 }
 
+/*
+ * Returns a pointer to the next data block
+ * in the mapped file, up to size bytes long,
+ * so it can be sent without copying it first
+ * @arg len       Length of the block returned
+ * @arg size      Largest block wanted
+ * @return        Pointer into the mapping
+ */
+char *Extractor_getNextDataPointer ( int *len, int size, thread_Settings *mSettings ) {
+    char *data = mSettings->Extractor_map + mSettings->Extractor_offset;
+    max_size_t left = mSettings->Extractor_mapsize - mSettings->Extractor_offset;
+
+    *len = ( left < (max_size_t) size ? (int) left : size );
+    Extractor_advance( *len, mSettings );
+    return data;
+}
+
+/*
+ * Sends the next data block from the file
+ * directly to the socket with sendfile(),
+ * avoiding the copies through user space
+ * @arg sock      Socket to send on
+ * @return        Number of bytes sent, 0 at
+ *                end of file, -1 on error
+ */
+int Extractor_sendNextDataBlock ( int sock, thread_Settings *mSettings ) {
+#if defined(HAVE_SENDFILE) && defined(HAVE_SYS_SENDFILE_H)
+    off_t offset = mSettings->Extractor_offset;
+    ssize_t len;
+
+    if ( mSettings->Extractor_file == NULL ) {
+        return 0;
+    }
+    len = sendfile( sock, fileno( mSettings->Extractor_file ), 
+                    &offset, mSettings->Extractor_size );
+    if ( len == 0 && isFileLoop( mSettings ) && offset > 0 ) {
+        // end of file, start again from the beginning
+        offset = 0;
+        len = sendfile( sock, fileno( mSettings->Extractor_file ), 
+                        &offset, mSettings->Extractor_size );
+    }
+    mSettings->Extractor_offset = offset;
+    return len;
+#else
+    errno = ENOSYS;
+    return -1;
+#endif
+}
+
 /**
  * Function which determines whether
  * the file stream is still readable
  * @return boolean    true, if readable; false, if not
  */
 int Extractor_canRead ( thread_Settings *mSettings ) {
+    if ( mSettings->Extractor_map != NULL ) {
+        return( mSettings->Extractor_offset < mSettings->Extractor_mapsize );
+    }
     return(( mSettings->Extractor_file != NULL ) 
            && !(feof( mSettings->Extractor_file )));
 }
 
+/**
+ * Function which determines whether blocks
+ * can be taken from a mapping of the file
+ * with Extractor_getNextDataPointer
+ * @return boolean    true, if mapped
+ */
+int Extractor_isMapped ( thread_Settings *mSettings ) {
+    return( mSettings->Extractor_map != NULL );
+}
+
 /**
  * This is used to reduce the read size
  * Used in UDP transfer to accomodate the
@@ -0,0 +1,272 @@
+/*--------------------------------------------------------------- 
+ * Copyright (c) 1999,2000,2001,2002,2003                              
+ * The Board of Trustees of the University of Illinois            
+ * All Rights Reserved.                                           
+ *--------------------------------------------------------------- 
+ * Permission is hereby granted, free of charge, to any person    
+ * obtaining a copy of this software (Iperf) and associated       
+ * documentation files (the "Software"), to deal in the Software  
+ * without restriction, including without limitation the          
+ * rights to use, copy, modify, merge, publish, distribute,        
+ * sublicense, and/or sell copies of the Software, and to permit     
+ * persons to whom the Software is furnished to do
+ * so, subject to the following conditions: 
+ *
+ *     
+ * Redistributions of source code must retain the above 
+ * copyright notice, this list of conditions and 
+ * the following disclaimers. 
+ *
+ *     
+ * Redistributions in binary form must reproduce the above 
+ * copyright notice, this list of conditions and the following 
+ * disclaimers in the documentation and/or other materials 
+ * provided with the distribution. 
+ * 
+ *     
+ * Neither the names of the University of Illinois, NCSA, 
+ * nor the names of its contributors may be used to endorse 
+ * or promote products derived from this Software without
+ * specific prior written permission. 
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, 
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES 
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND 
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE CONTIBUTORS OR COPYRIGHT 
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, 
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, 
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE. 
+ * ________________________________________________________________
+ * National Laboratory for Applied Network Research 
+ * National Center for Supercomputing Applications 
+ * University of Illinois at Urbana-Champaign 
+ * http://www.ncsa.uiuc.edu
+ * ________________________________________________________________ 
+ * IOUring.c
+ * -------------------------------------------------------------------
+ * Set up and drive an io_uring with the io_uring_setup, 
+ * io_uring_enter and io_uring_register system calls. The rings are
+ * shared with the kernel, so heads and tails are read and published
+ * with acquire and release ordering.
+ * ------------------------------------------------------------------- 
+ */
+
+#include "IOUring.h"
+#include "BufferPool.h"
+
+#ifdef HAVE_IO_URING
+
+#define IOUring_load( p )       __atomic_load_n( p, __ATOMIC_ACQUIRE )
+#define IOUring_store( p, v )   __atomic_store_n( p, v, __ATOMIC_RELEASE )
+
+static int IOUring_setup ( unsigned entries, struct io_uring_params *p ) {
+    return (int) syscall( __NR_io_uring_setup, entries, p );
+}
+
+static int IOUring_enter ( int fd, unsigned submit, unsigned wait, 
+                           unsigned flags ) {
+    return (int) syscall( __NR_io_uring_enter, fd, submit, wait, flags, 
+                          NULL, 0 );
+}
+
+static int IOUring_register ( int fd, unsigned opcode, void *arg, 
+                              unsigned args ) {
+    return (int) syscall( __NR_io_uring_register, fd, opcode, arg, args );
+}
+
+int IOUring_Initialize ( IOUring *ring, unsigned entries ) {
+    struct io_uring_params p;
+    char *sq;
+    char *cq;
+
+    memset( ring, 0, sizeof(IOUring) );
+    memset( &p, 0, sizeof(p) );
+    ring->fd = IOUring_setup( entries, &p );
+    if ( ring->fd < 0 ) {
+        ring->fd = -1;
+        return 0;
+    }
+
+    ring->sqRingSize = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+    ring->cqRingSize = p.cq_off.cqes + 
+                       p.cq_entries * sizeof(struct io_uring_cqe);
+    if ( p.features & IORING_FEAT_SINGLE_MMAP ) {
+        if ( ring->cqRingSize > ring->sqRingSize ) {
+            ring->sqRingSize = ring->cqRingSize;
+        }
+        ring->cqRingSize = ring->sqRingSize;
+    }
+    ring->sqRing = mmap( NULL, ring->sqRingSize, PROT_READ | PROT_WRITE,
+                         MAP_SHARED | MAP_POPULATE, ring->fd, 
+                         IORING_OFF_SQ_RING );
+    if ( ring->sqRing == MAP_FAILED ) {
+        ring->sqRing = NULL;
+        IOUring_Destroy( ring );
+        return 0;
+    }
+    if ( p.features & IORING_FEAT_SINGLE_MMAP ) {
+        ring->cqRing = ring->sqRing;
+    } else {
+        ring->cqRing = mmap( NULL, ring->cqRingSize, PROT_READ | PROT_WRITE,
+                             MAP_SHARED | MAP_POPULATE, ring->fd, 
+                             IORING_OFF_CQ_RING );
+        if ( ring->cqRing == MAP_FAILED ) {
+            ring->cqRing = NULL;
+            IOUring_Destroy( ring );
+            return 0;
+        }
+    }
+    ring->sqesSize = p.sq_entries * sizeof(struct io_uring_sqe);
+    ring->sqes = (struct io_uring_sqe*) mmap( NULL, ring->sqesSize, 
+                                              PROT_READ | PROT_WRITE,
+                                              MAP_SHARED | MAP_POPULATE, 
+                                              ring->fd, IORING_OFF_SQES );
+    if ( ring->sqes == MAP_FAILED ) {
+        ring->sqes = NULL;
+        IOUring_Destroy( ring );
+        return 0;
+    }
+
+    sq = (char*) ring->sqRing;
+    ring->sqHead  = (unsigned*) (sq + p.sq_off.head);
+    ring->sqTail  = (unsigned*) (sq + p.sq_off.tail);
+    ring->sqMask  = (unsigned*) (sq + p.sq_off.ring_mask);
+    ring->sqArray = (unsigned*) (sq + p.sq_off.array);
+    ring->sqTailLocal = *ring->sqTail;
+
+    cq = (char*) ring->cqRing;
+    ring->cqHead = (unsigned*) (cq + p.cq_off.head);
+    ring->cqTail = (unsigned*) (cq + p.cq_off.tail);
+    ring->cqMask = (unsigned*) (cq + p.cq_off.ring_mask);
+    ring->cqes   = (struct io_uring_cqe*) (cq + p.cq_off.cqes);
+    ring->entries = p.sq_entries;
+    return 1;
+}
+
+struct io_uring_sqe* IOUring_getSQE ( IOUring *ring ) {
+    struct io_uring_sqe *sqe;
+    unsigned head = IOUring_load( ring->sqHead );
+
+    if ( ring->sqTailLocal - head >= ring->entries ) {
+        return NULL;
+    }
+    sqe = &ring->sqes[ ring->sqTailLocal & *ring->sqMask ];
+    memset( sqe, 0, sizeof(struct io_uring_sqe) );
+    // the array is an identity map onto sqes
+    ring->sqArray[ ring->sqTailLocal & *ring->sqMask ] = 
+        ring->sqTailLocal & *ring->sqMask;
+    ring->sqTailLocal++;
+    ring->toSubmit++;
+    return sqe;
+}
+
+int IOUring_Submit ( IOUring *ring, unsigned wait ) {
+    unsigned submit = ring->toSubmit;
+    int rc;
+
+    IOUring_store( ring->sqTail, ring->sqTailLocal );
+    if ( submit == 0 && wait == 0 ) {
+        return 0;
+    }
+    rc = IOUring_enter( ring->fd, submit, wait, 
+                        (wait > 0 ? IORING_ENTER_GETEVENTS : 0) );
+    if ( rc < 0 ) {
+        return -errno;
+    }
+    ring->toSubmit -= ((unsigned) rc < submit ? (unsigned) rc : submit);
+    return rc;
+}
+
+struct io_uring_cqe* IOUring_peekCQE ( IOUring *ring ) {
+    unsigned head = *ring->cqHead;
+
+    if ( head == IOUring_load( ring->cqTail ) ) {
+        return NULL;
+    }
+    return &ring->cqes[ head & *ring->cqMask ];
+}
+
+void IOUring_seenCQE ( IOUring *ring ) {
+    IOUring_store( ring->cqHead, *ring->cqHead + 1 );
+}
+
+int IOUring_RegisterBuffer ( IOUring *ring, void *base, size_t len ) {
+    struct iovec iov;
+
+    iov.iov_base = base;
+    iov.iov_len  = len;
+    return IOUring_register( ring->fd, IORING_REGISTER_BUFFERS, &iov, 1 ) == 0;
+}
+
+int IOUring_SetupBufRing ( IOUring *ring, unsigned entries, int size ) {
+    struct io_uring_buf_reg reg;
+    unsigned i;
+
+    ring->bufRingSize = entries * sizeof(struct io_uring_buf);
+    ring->bufRing = (struct io_uring_buf_ring*) 
+        mmap( NULL, ring->bufRingSize, PROT_READ | PROT_WRITE,
+              MAP_ANONYMOUS | MAP_PRIVATE, -1, 0 );
+    if ( ring->bufRing == MAP_FAILED ) {
+        ring->bufRing = NULL;
+        return 0;
+    }
+    memset( &reg, 0, sizeof(reg) );
+    reg.ring_addr = (unsigned long) ring->bufRing;
+    reg.ring_entries = entries;
+    reg.bgid = 0;
+    if ( IOUring_register( ring->fd, IORING_REGISTER_PBUF_RING, &reg, 1 ) != 0 ) {
+        munmap( ring->bufRing, ring->bufRingSize );
+        ring->bufRing = NULL;
+        return 0;
+    }
+    ring->bufs = BufferPool_Get( (size_t) entries * size );
+    ring->bufEntries = entries;
+    ring->bufSize = size;
+    ring->bufTail = 0;
+    for ( i = 0; i < entries; i++ ) {
+        IOUring_putBuffer( ring, (unsigned short) i );
+    }
+    return 1;
+}
+
+char* IOUring_getBuffer ( IOUring *ring, unsigned short bid ) {
+    return ring->bufs + (size_t) bid * ring->bufSize;
+}
+
+void IOUring_putBuffer ( IOUring *ring, unsigned short bid ) {
+    struct io_uring_buf *buf;
+
+    buf = &ring->bufRing->bufs[ ring->bufTail & (ring->bufEntries - 1) ];
+    buf->addr = (unsigned long) IOUring_getBuffer( ring, bid );
+    buf->len  = ring->bufSize;
+    buf->bid  = bid;
+    ring->bufTail++;
+    // the tail shares the first entry's resv field
+    IOUring_store( &ring->bufRing->tail, ring->bufTail );
+}
+
+void IOUring_Destroy ( IOUring *ring ) {
+    if ( ring->sqes != NULL ) {
+        munmap( ring->sqes, ring->sqesSize );
+    }
+    if ( ring->cqRing != NULL && ring->cqRing != ring->sqRing ) {
+        munmap( ring->cqRing, ring->cqRingSize );
+    }
+    if ( ring->sqRing != NULL ) {
+        munmap( ring->sqRing, ring->sqRingSize );
+    }
+    if ( ring->fd >= 0 ) {
+        close( ring->fd );
+    }
+    if ( ring->bufRing != NULL ) {
+        munmap( ring->bufRing, ring->bufRingSize );
+    }
+    if ( ring->bufs != NULL ) {
+        BufferPool_Put( ring->bufs );
+    }
+    memset( ring, 0, sizeof(IOUring) );
+    ring->fd = -1;
+}
+
+#endif // HAVE_IO_URING
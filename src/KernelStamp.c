@@ -0,0 +1,176 @@
+/*--------------------------------------------------------------- 
+ * Copyright (c) 1999,2000,2001,2002,2003                              
+ * The Board of Trustees of the University of Illinois            
+ * All Rights Reserved.                                           
+ *--------------------------------------------------------------- 
+ * Permission is hereby granted, free of charge, to any person    
+ * obtaining a copy of this software (Iperf) and associated       
+ * documentation files (the "Software"), to deal in the Software  
+ * without restriction, including without limitation the          
+ * rights to use, copy, modify, merge, publish, distribute,        
+ * sublicense, and/or sell copies of the Software, and to permit     
+ * persons to whom the Software is furnished to do
+ * so, subject to the following conditions: 
+ *
+ *     
+ * Redistributions of source code must retain the above 
+ * copyright notice, this list of conditions and 
+ * the following disclaimers. 
+ *
+ *     
+ * Redistributions in binary form must reproduce the above 
+ * copyright notice, this list of conditions and the following 
+ * disclaimers in the documentation and/or other materials 
+ * provided with the distribution. 
+ * 
+ *     
+ * Neither the names of the University of Illinois, NCSA, 
+ * nor the names of its contributors may be used to endorse 
+ * or promote products derived from this Software without
+ * specific prior written permission. 
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, 
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES 
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND 
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE CONTIBUTORS OR COPYRIGHT 
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, 
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, 
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE. 
+ * ________________________________________________________________
+ * National Laboratory for Applied Network Research 
+ * National Center for Supercomputing Applications 
+ * University of Illinois at Urbana-Champaign 
+ * http://www.ncsa.uiuc.edu
+ * ________________________________________________________________ 
+ * KernelStamp.c
+ * -------------------------------------------------------------------
+ * SO_TIMESTAMPNS receive stamps and SO_TIMESTAMPING transmit stamps,
+ * Linux only. Elsewhere nothing is stamped, the reports keep the times
+ * the datagrams were read and say nothing of the sender's stack.
+ * ------------------------------------------------------------------- 
+ */
+
+#include "KernelStamp.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+int KernelStamp_EnableRX( int sock ) {
+#ifdef SO_TIMESTAMPNS
+    int on = 1;
+    return setsockopt( sock, SOL_SOCKET, SO_TIMESTAMPNS, (char*) &on, sizeof(on) );
+#else
+    errno = ENOPROTOOPT;
+    return -1;
+#endif
+}
+
+int KernelStamp_ControlLen( void ) {
+#ifdef SO_TIMESTAMPNS
+    return CMSG_SPACE( sizeof(struct timespec) );
+#else
+    return 0;
+#endif
+}
+
+void KernelStamp_ClockOffset( struct timespec *offset ) {
+    struct timespec mono, wall;
+#ifdef HAVE_CLOCK_GETTIME
+    clock_gettime( CLOCK_REALTIME, &wall );
+#else
+    struct timeval tv;
+    gettimeofday( &tv, NULL );
+    wall.tv_sec = tv.tv_sec;
+    wall.tv_nsec = tv.tv_usec * 1000;
+#endif
+    gettime_monotonic( &mono );
+    offset->tv_sec = wall.tv_sec - mono.tv_sec;
+    offset->tv_nsec = wall.tv_nsec - mono.tv_nsec;
+    if ( offset->tv_nsec < 0 ) {
+        offset->tv_nsec += 1000000000;
+        offset->tv_sec--;
+    }
+}
+
+int KernelStamp_RX( struct msghdr *msg, const struct timespec *offset, 
+                    struct timespec *stamp ) {
+#ifdef SO_TIMESTAMPNS
+    struct cmsghdr *cmsg;
+
+    if ( msg->msg_controllen == 0 ) {
+        return 0;
+    }
+    for ( cmsg = CMSG_FIRSTHDR( msg ); cmsg != NULL; cmsg = CMSG_NXTHDR( msg, cmsg ) ) {
+        if ( cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_TIMESTAMPNS ) {
+            struct timespec wall;
+            memcpy( &wall, CMSG_DATA( cmsg ), sizeof(wall) );
+            stamp->tv_sec = wall.tv_sec - offset->tv_sec;
+            stamp->tv_nsec = wall.tv_nsec - offset->tv_nsec;
+            if ( stamp->tv_nsec < 0 ) {
+                stamp->tv_nsec += 1000000000;
+                stamp->tv_sec--;
+            }
+            return 1;
+        }
+    }
+#endif
+    return 0;
+}
+
+int KernelStamp_EnableTX( int sock ) {
+#ifdef HAVE_TX_TIMESTAMPS
+    // stamps come back with just the datagram number, not the datagram
+    int flags = SOF_TIMESTAMPING_TX_SOFTWARE | SOF_TIMESTAMPING_SOFTWARE |
+                SOF_TIMESTAMPING_OPT_ID | SOF_TIMESTAMPING_OPT_TSONLY;
+    return setsockopt( sock, SOL_SOCKET, SO_TIMESTAMPING, (char*) &flags, sizeof(flags) );
+#else
+    errno = ENOPROTOOPT;
+    return -1;
+#endif
+}
+
+int KernelStamp_TX( int sock, u_int32_t *key, struct timespec *stamp ) {
+#ifdef HAVE_TX_TIMESTAMPS
+    char control[256];
+    struct msghdr msg;
+    struct cmsghdr *cmsg;
+
+    for ( ;; ) {
+        struct scm_timestamping *tss = NULL;
+        struct sock_extended_err *serr = NULL;
+
+        memset( &msg, 0, sizeof(msg) );
+        msg.msg_control = control;
+        msg.msg_controllen = sizeof(control);
+        if ( recvmsg( sock, &msg, MSG_ERRQUEUE | MSG_DONTWAIT ) < 0 ) {
+            return 0;
+        }
+        // a stamp and the error carrying its number come together
+        for ( cmsg = CMSG_FIRSTHDR( &msg ); cmsg != NULL; 
+              cmsg = CMSG_NXTHDR( &msg, cmsg ) ) {
+            if ( cmsg->cmsg_level == SOL_SOCKET && 
+                 cmsg->cmsg_type == SCM_TIMESTAMPING ) {
+                tss = (struct scm_timestamping*) CMSG_DATA( cmsg );
+            } else if ( (cmsg->cmsg_level == SOL_IP && cmsg->cmsg_type == IP_RECVERR) ||
+                        (cmsg->cmsg_level == SOL_IPV6 && cmsg->cmsg_type == IPV6_RECVERR) ) {
+                serr = (struct sock_extended_err*) CMSG_DATA( cmsg );
+            }
+        }
+        if ( tss != NULL && serr != NULL && serr->ee_errno == ENOMSG &&
+             serr->ee_origin == SO_EE_ORIGIN_TIMESTAMPING &&
+             (tss->ts[0].tv_sec != 0 || tss->ts[0].tv_nsec != 0) ) {
+            *key = serr->ee_data;
+            *stamp = tss->ts[0];
+            return 1;
+        }
+    }
+#else
+    return 0;
+#endif
+}
+
+#ifdef __cplusplus
+} /* end extern "C" */
+#endif
@@ -57,9 +57,28 @@
 #include "Thread.h"
 #include "Settings.hpp"
 #include "Client.hpp"
+#include "ClientEngine.hpp"
+#include "ServerEngine.hpp"
 #include "Listener.hpp"
 #include "Server.hpp"
 #include "PerfSocket.hpp"
+#include "Locale.h"
+#include "Affinity.h"
+
+/*
+ * With --affinity a stream or server thread is pinned to its CPU
+ * first thing, so the buffers it then allocates and touches come
+ * from that CPU's NUMA node.
+ */
+static void thread_pin( thread_Settings *thread ) {
+    if ( thread->mCPU >= 0 ) {
+        int rc = Affinity_Pin( &thread->mCPU, 1 );
+        if ( rc != 0 ) {
+            fprintf( stderr, warn_affinity_failed, "stream", strerror( rc ) );
+            thread->mCPU = -1;
+        }
+    }
+}
 
 /*
  * listener_spawn is responsible for creating a Listener class
@@ -69,6 +88,9 @@
 void listener_spawn( thread_Settings *thread ) {
     Listener *theListener = NULL;
 
+    // UDP --workers shards other than the first are pinned here
+    thread_pin( thread );
+
     // start up a listener
     theListener = new Listener( thread );
 #ifndef WIN32
@@ -91,6 +113,8 @@ void listener_spawn( thread_Settings *thread ) {
 void server_spawn( thread_Settings *thread) {
     Server *theServer = NULL;
 
+    thread_pin( thread );
+
     // Start up the server
     theServer = new Server( thread );
     
@@ -99,6 +123,24 @@ void server_spawn( thread_Settings *thread) {
     DELETE_PTR( theServer);
 }
 
+/*
+ * worker_spawn runs one of the Listener's --workers server threads.
+ * The Listener created its ServerEngine and hands it connections;
+ * the engine is freed here once the Listener has shut it down.
+ * After a Ctrl-C it is left for the Listener, which may still hold it.
+ */
+void worker_spawn( thread_Settings *thread ) {
+#ifdef HAVE_SYS_EPOLL_H
+    ServerEngine *engine = (ServerEngine*) thread->mEngine;
+
+    thread_pin( thread );
+    engine->Run();
+    if ( !sInterupted ) {
+        DELETE_PTR( engine );
+    }
+#endif
+}
+
 /*
  * client_spawn is responsible for creating a Client class
  * and launching the client. It is provided as a means for
@@ -107,6 +149,17 @@ void server_spawn( thread_Settings *thread) {
 void client_spawn( thread_Settings *thread ) {
     Client *theClient = NULL;
 
+    thread_pin( thread );
+
+#ifdef HAVE_SYS_EPOLL_H
+    // a --workers thread runs its streams from one event loop
+    if ( thread->mWorkerStreams > 0 ) {
+        ClientEngine engine( thread );
+        engine.Run();
+        return;
+    }
+#endif
+
     //start up the client
     theClient = new Client( thread );
 
@@ -151,12 +204,69 @@ void client_init( thread_Settings *clients ) {
         itr = next;
     }
 #endif
+    // Without --seed pick one now, so the settings report can show
+    // it and the run can be repeated
+    if ( (clients->mGapDist != kGap_Constant || clients->mSizeCount > 0) &&
+         clients->mSeed == 0 ) {
+        clients->mSeed = (u_int32_t) time( NULL );
+    }
+
+#if defined(HAVE_SYS_EPOLL_H) && defined(HAVE_THREAD)
+    // With --workers the -P streams are split over that many
+    // threads, each of which runs its streams from an event loop.
+    // Stream i still gets seed + i.
+    if ( clients->mWorkers > 0 ) {
+        int streams = ( clients->mThreads > 1 ? clients->mThreads : 1 );
+        int workers = ( clients->mWorkers < streams ? clients->mWorkers : streams );
+        int first = 0;
+        struct rlimit limit;
+
+        // every stream holds a socket open for the whole test
+        if ( getrlimit( RLIMIT_NOFILE, &limit ) == 0 && 
+             limit.rlim_cur < limit.rlim_max ) {
+            limit.rlim_cur = limit.rlim_max;
+            setrlimit( RLIMIT_NOFILE, &limit );
+        }
+
+        for (int i = 0; i < workers; i++) {
+            int share = streams / workers + (i < streams % workers ? 1 : 0);
+            if ( i == 0 ) {
+                next = clients;
+            } else {
+                Settings_Copy( clients, &next );
+                unsetReport( next );
+                next->mSeed = clients->mSeed + first;
+                itr->runNow = next;
+                itr = next;
+            }
+            next->mWorkerStreams = share;
+            if ( clients->mCPUCount > 0 ) {
+                next->mCPU = clients->mCPUs[ i % clients->mCPUCount ];
+            }
+            first += share;
+        }
+        return;
+    }
+#else
+    if ( clients->mWorkers > 0 ) {
+        fprintf( stderr, warn_workers_unsupported );
+    }
+#endif
+
     // For each of the needed threads create a copy of the
     // provided settings, unsetting the report flag and add
-    // to the list of threads to start
+    // to the list of threads to start. Each stream draws its
+    // gaps from its own seed and takes the next --affinity CPU.
+    if ( clients->mCPUCount > 0 ) {
+        clients->mCPU = clients->mCPUs[0];
+    }
     for (int i = 1; i < clients->mThreads; i++) {
         Settings_Copy( clients, &next );
         unsetReport( next );
+        next->mSeed = clients->mSeed + i;
+        if ( clients->mCPUCount > 0 ) {
+            next->mCPU = clients->mCPUs[ i % clients->mCPUCount ];
+        }
         itr->runNow = next;
         itr = next;
     }
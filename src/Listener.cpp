@@ -78,7 +78,20 @@
 #include "SocketAddr.h"
 #include "PerfSocket.hpp"
 #include "List.h"
+#include "ServerEngine.hpp"
+#include "Locale.h"
+#include "BufferPool.h"
 #include "util.h" 
+#include "Affinity.h"
+
+/*
+ * UDP --workers flows ended by any shard, under clients_mutex. With
+ * server -P the shards poll it and all stop once that many have ended.
+ */
+static int sShardFlowsEnded = 0;
+
+// how often a shard waiting on its socket checks the count, in usecs
+const long kShardPoll_usecs = 100000;
 
 /* ------------------------------------------------------------------- 
  * Stores local hostname and socket info. 
@@ -89,12 +102,41 @@ Listener::Listener( thread_Settings *inSettings ) {
     mClients = inSettings->mThreads;
     mBuf = NULL;
     mSettings = inSettings;
+    mEngines = NULL;
+    mEngineCount = 0;
+    mNextEngine = 0;
+    mNextCPU = 0;
+    mBatchBufs = NULL;
+    mBatchMsgs = NULL;
+    mBatchIov = NULL;
+    mBatchPeers = NULL;
+    mBatchCount = 0;
+    mBatchNext = 0;
+    mShardCount = 0;
+    mFlows = NULL;
+#if defined(SO_REUSEPORT) && defined(HAVE_THREAD) && !defined(WIN32)
+    if ( isUDP( mSettings ) && mSettings->mWorkers > 0 && 
+         !isMulticast( mSettings ) ) {
+        mShardCount = mSettings->mWorkers;
+    }
+#endif
 
     // initialize buffer
-    mBuf = new char[ mSettings->mBufLen ];
+    mBuf = BufferPool_Get( mSettings->mBufLen );
 
-    // open listening socket 
-    Listen( ); 
+    // open listening socket, the other UDP --workers shards
+    // are handed theirs by the first
+    if ( mSettings->mShard == 0 ) {
+        Listen( ); 
+        if ( isUDP( mSettings ) && mSettings->mWorkers > 0 ) {
+            if ( mShardCount == 0 ) {
+                fprintf( stderr, warn_workers_udp );
+                mSettings->mWorkers = 0;
+            } else {
+                SteerShards( );
+            }
+        }
+    }
     ReportSettings( inSettings );
 
 } // end Listener 
@@ -108,7 +150,14 @@ Listener::~Listener() {
         WARN_errno( rc == SOCKET_ERROR, "close" );
         mSettings->mSock = INVALID_SOCKET;
     }
-    DELETE_ARRAY( mBuf );
+    BufferPool_Put( mBuf );
+    BufferPool_Put( mBatchBufs );
+#ifdef HAVE_RECVMMSG
+    DELETE_ARRAY( mBatchMsgs );
+#endif
+    DELETE_ARRAY( mBatchIov );
+    DELETE_ARRAY( mBatchPeers );
+    Iperf_destroy( &mFlows );
 } // end ~Listener 
 
 /* ------------------------------------------------------------------- 
@@ -118,6 +167,13 @@ Listener::~Listener() {
  *          spawn a new Server thread. 
  * ------------------------------------------------------------------- */ 
 void Listener::Run( void ) {
+    if ( mShardCount > 0 ) {
+        // every shard serves the flows the kernel steers to its socket
+        if ( mSettings->mShard == 0 ) {
+            StartShards();
+        }
+        UDPSingleServer();
+    } else
 #ifdef WIN32
     if ( isUDP( mSettings ) && !isSingleUDP( mSettings ) ) {
         UDPSingleServer();
@@ -149,7 +205,7 @@ void Listener::Run( void ) {
         }
         Settings_Copy( mSettings, &server );
         server->mThreadMode = kMode_Server;
-    
+        StartWorkers();
     
         // Accept each packet, 
         // If there is no existing client, then start  
@@ -247,6 +303,12 @@ void Listener::Run( void ) {
                 }
             }
     
+            // --affinity puts each client's thread on the next CPU
+            if ( mSettings->mCPUCount > 0 ) {
+                server->mCPU = mSettings->mCPUs[ mNextCPU ];
+                mNextCPU = (mNextCPU + 1) % mSettings->mCPUCount;
+            }
+
             // Start the server
 #if defined(WIN32) && defined(HAVE_THREAD)
             if ( UDP ) {
@@ -259,6 +321,18 @@ void Listener::Run( void ) {
                     thread_start( server->runNext );
                 }
             } else
+#endif
+#ifdef HAVE_SYS_EPOLL_H
+            if ( mEngines != NULL ) {
+                // a worker serves the connection, a -d test back to
+                // the client still gets its own threads
+                if ( server->runNow != NULL ) {
+                    thread_start( server->runNow );
+                    server->runNow = NULL;
+                }
+                mEngines[mNextEngine]->Add( server );
+                mNextEngine = (mNextEngine + 1) % mEngineCount;
+            } else
 #endif
             thread_start( server );
     
@@ -277,9 +351,117 @@ void Listener::Run( void ) {
         } while ( !sInterupted && (!mCount || ( mCount && mClients > 0 )) );
     
         Settings_Destroy( server );
+        StopWorkers();
     }
 } // end Run 
 
+/* -------------------------------------------------------------------
+ * With --workers, start a pool of threads that each serve their
+ * share of the TCP connections from an event loop. UDP is served
+ * by the shards StartShards starts instead.
+ * ------------------------------------------------------------------- */
+void Listener::StartWorkers( void ) {
+    if ( mSettings->mWorkers <= 0 ) {
+        return;
+    }
+#if defined(HAVE_SYS_EPOLL_H) && defined(HAVE_THREAD)
+    mEngineCount = mSettings->mWorkers;
+    mEngines = new ServerEngine*[ mEngineCount ];
+    for ( int i = 0; i < mEngineCount; i++ ) {
+        thread_Settings *worker = NULL;
+
+        Settings_Copy( mSettings, &worker );
+        worker->mThreadMode = kMode_Worker;
+        worker->mSock = INVALID_SOCKET;
+        if ( mSettings->mCPUCount > 0 ) {
+            worker->mCPU = mSettings->mCPUs[ i % mSettings->mCPUCount ];
+        }
+        mEngines[i] = new ServerEngine( worker );
+        worker->mEngine = mEngines[i];
+        thread_start( worker );
+    }
+#else
+    fprintf( stderr, warn_workers_unsupported );
+#endif
+}
+
+/* -------------------------------------------------------------------
+ * Each worker exits, and frees its engine, once its connections end.
+ * ------------------------------------------------------------------- */
+void Listener::StopWorkers( void ) {
+#ifdef HAVE_SYS_EPOLL_H
+    for ( int i = 0; i < mEngineCount; i++ ) {
+        mEngines[i]->Shutdown();
+    }
+#endif
+    DELETE_ARRAY( mEngines );
+    mEngineCount = 0;
+}
+
+/* -------------------------------------------------------------------
+ * With UDP --workers, bind another SO_REUSEPORT socket to the port
+ * for each of the other shards and start a listener thread to read
+ * it. The kernel hands each flow to one socket, so each shard runs
+ * its own UDPSingleServer on its flows without sharing a lock per
+ * datagram, and the reports are summed per client as before.
+ * ------------------------------------------------------------------- */
+void Listener::StartShards( void ) {
+    int first = mSettings->mSock;
+
+    for ( int i = 1; i < mShardCount; i++ ) {
+        thread_Settings *shard = NULL;
+
+        // bind in shard order, the group indexes its sockets by it
+        Listen( );
+        Settings_Copy( mSettings, &shard );
+        mSettings->mSock = first;
+        shard->mShard = i;
+        unsetDaemon( shard );
+        setNoSettReport( shard );
+        if ( mSettings->mCPUCount > 0 ) {
+            shard->mCPU = mSettings->mCPUs[ i % mSettings->mCPUCount ];
+        }
+        thread_start( shard );
+    }
+    if ( mSettings->mCPUCount > 0 ) {
+        int rc = Affinity_Pin( mSettings->mCPUs, 1 );
+        if ( rc != 0 ) {
+            fprintf( stderr, warn_affinity_failed, "listener", strerror( rc ) );
+        }
+    }
+}
+
+/* -------------------------------------------------------------------
+ * With --reuseport-cpu, pick the socket for each datagram by the CPU
+ * that received it rather than by the hash of its addresses, so with
+ * --affinity 0-N the shard pinned to a CPU reads what it received.
+ * ------------------------------------------------------------------- */
+void Listener::SteerShards( void ) {
+    if ( !mSettings->mReusePortCPU ) {
+        return;
+    }
+#ifdef HAVE_REUSEPORT_CBPF
+    struct sock_filter code[] = {
+        // A = the receiving CPU % the number of shards
+        { BPF_LD  | BPF_W | BPF_ABS, 0, 0, (u_int32_t) (SKF_AD_OFF + SKF_AD_CPU) },
+        { BPF_ALU | BPF_MOD | BPF_K, 0, 0, (u_int32_t) mShardCount },
+        { BPF_RET | BPF_A, 0, 0, 0 }
+    };
+    struct sock_fprog prog;
+
+    prog.len = sizeof(code) / sizeof(code[0]);
+    prog.filter = code;
+    if ( setsockopt( mSettings->mSock, SOL_SOCKET, SO_ATTACH_REUSEPORT_CBPF, 
+                     (char*) &prog, sizeof(prog) ) == 0 ) {
+        return;
+    }
+    fprintf( stderr, warn_reuseport_cpu, strerror( errno ) );
+#else
+    fprintf( stderr, warn_reuseport_cpu, strerror( ENOSYS ) );
+#endif
+    mSettings->mReusePortCPU = 0;
+}
+
 /* -------------------------------------------------------------------
  * Setup a socket listening on a port.
  * For TCP, this calls bind() and listen().
@@ -322,6 +504,15 @@ void Listener::Listen( ) {
     int boolean = 1;
     Socklen_t len = sizeof(boolean);
     setsockopt( mSettings->mSock, SOL_SOCKET, SO_REUSEADDR, (char*) &boolean, len );
+#ifdef SO_REUSEPORT
+    // UDP --workers shards share the port, the kernel spreads the flows
+    if ( mShardCount > 0 ) {
+        rc = setsockopt( mSettings->mSock, SOL_SOCKET, SO_REUSEPORT, (char*) &boolean, len );
+        if ( rc == SOCKET_ERROR ) {
+            mShardCount = 0;
+        }
+    }
+#endif
 
     // bind socket to server address
 #ifdef WIN32
@@ -336,9 +527,9 @@ void Listener::Listen( ) {
         WARN_errno( rc == SOCKET_ERROR, "bind" );
     }
     // listen for connections (TCP only).
-    // default backlog traditionally 5
+    // default backlog traditionally 5, --workers expects many clients
     if ( !isUDP( mSettings ) ) {
-        rc = listen( mSettings->mSock, 5 );
+        rc = listen( mSettings->mSock, (mSettings->mWorkers > 0 ? SOMAXCONN : 5) );
         WARN_errno( rc == SOCKET_ERROR, "listen" );
     }
 
@@ -466,13 +657,21 @@ void Listener::Accept( thread_Settings *server ) {
 void Listener::UDPSingleServer( ) {
     
     bool client = false, UDP = isUDP( mSettings ), mCount = (mSettings->mThreads != 0);
+    bool sharded = (mShardCount > 0), done = false;
     thread_Settings *tempSettings = NULL;
     Iperf_ListEntry *exist, *listtemp;
+    // a shard looks its datagrams up in its own flows, and takes the
+    // clients lock only for a new or ending flow
+    Iperf_ListEntry **flows = (sharded ? &mFlows : &clients);
     int rc;
     int32_t datagramID;
+    struct timespec arrived;
     client_hdr* hdr = ( UDP ? (client_hdr*) (((UDP_datagram*)mBuf) + 1) : 
                               (client_hdr*) mBuf);
     ReportStruct *reportstruct = new ReportStruct;
+    reportstruct->verified = 0;
+    reportstruct->corrupt = 0;
+    reportstruct->appDelay = -1;
     
     if ( mSettings->mHost != NULL ) {
         client = true;
@@ -486,13 +685,24 @@ void Listener::UDPSingleServer( ) {
     // If there is no existing client, then start  
     // a new report to service the new client 
     // The listener runs in a single thread 
-    Mutex_Lock( &clients_mutex );
+    if ( !sharded ) {
+        Mutex_Lock( &clients_mutex );
+    }
+#ifdef SO_RCVTIMEO
+    if ( sharded && mCount ) {
+        // wake now and then to see if the other shards ended the test
+        struct timeval timeout;
+        timeout.tv_sec = 0;
+        timeout.tv_usec = kShardPoll_usecs;
+        rc = setsockopt( mSettings->mSock, SOL_SOCKET, SO_RCVTIMEO, 
+                         (char*) &timeout, sizeof(timeout) );
+        WARN_errno( rc == SOCKET_ERROR, "setsockopt SO_RCVTIMEO" );
+    }
+#endif
     do {
         // Get next packet
         while ( sInterupted == 0) {
-            server->size_peer = sizeof( iperf_sockaddr );
-            rc = recvfrom( mSettings->mSock, mBuf, mSettings->mBufLen, 0, 
-                           (struct sockaddr*) &server->peer, &server->size_peer );
+            rc = RecvFrom( &arrived );
             if ( rc == SOCKET_ERROR ) {
 #if defined(WIN32) || defined(_WIN32_WCE)
 			    int my_err = WSAGetLastError();
@@ -500,14 +710,33 @@ void Listener::UDPSingleServer( ) {
 					continue;
 				}
 #endif 
+                if ( sharded && (errno == EAGAIN || errno == EWOULDBLOCK) ) {
+                    Mutex_Lock( &clients_mutex );
+                    done = (mCount && sShardFlowsEnded >= mSettings->mThreads);
+                    Mutex_Unlock( &clients_mutex );
+                    if ( done ) {
+                        break;
+                    }
+                    continue;
+                }
 				WARN_errno( rc == SOCKET_ERROR, "recvfrom" );
                 return;
             }
         
         
             // Handle connection for UDP sockets.
-            exist = Iperf_present( &server->peer, clients);
+            exist = Iperf_present( &server->peer, *flows );
             datagramID = ntohl( ((UDP_datagram*) mBuf)->id ); 
+            if ( exist == NULL && sharded ) {
+                // leave a flow another shard serves to it, its socket
+                // gets the flow's datagrams unless the steering changed
+                Mutex_Lock( &clients_mutex );
+                exist = Iperf_present( &server->peer, clients );
+                Mutex_Unlock( &clients_mutex );
+                if ( exist != NULL ) {
+                    continue;
+                }
+            }
             if ( datagramID >= 0 ) {
                 if ( exist != NULL ) {
                     // read the datagram ID and sentTime out of the buffer 
@@ -516,7 +745,20 @@ void Listener::UDPSingleServer( ) {
                     reportstruct->sentTime.tv_usec = ntohl( ((UDP_datagram*) mBuf)->tv_usec ); 
         
                     reportstruct->packetLen = rc;
-                    gettimeofday( &(reportstruct->packetTime), NULL );
+                    reportstruct->packetTime = arrived;
+
+                    // --isochronous datagrams carry their frame after the client_hdr
+                    reportstruct->frameID = 0;
+                    if ( rc >= (int) (sizeof(UDP_datagram) + sizeof(client_hdr) 
+                                      + sizeof(isoch_hdr)) &&
+                         (ntohl( hdr->flags ) & HEADER_ISOCH) != 0 ) {
+                        isoch_hdr *isoch = (isoch_hdr*) (hdr + 1);
+                        reportstruct->frameID = ntohl( isoch->frameid );
+                        reportstruct->frameBurst = ntohl( isoch->burstsize );
+                        reportstruct->frameTime.tv_sec = ntohl( isoch->start_tv_sec );
+                        reportstruct->frameTime.tv_usec = ntohl( isoch->start_tv_usec );
+                        gettimeofday( &(reportstruct->recvTime), NULL );
+                    }
         
                     ReportPacket( exist->server->reporthdr, reportstruct );
                 } else {
@@ -537,11 +779,11 @@ void Listener::UDPSingleServer( ) {
                     reportstruct->sentTime.tv_usec = ntohl( ((UDP_datagram*) mBuf)->tv_usec ); 
         
                     reportstruct->packetLen = rc;
-                    gettimeofday( &(reportstruct->packetTime), NULL );
+                    reportstruct->packetTime = arrived;
         
                     ReportPacket( exist->server->reporthdr, reportstruct );
                     // stop timing 
-                    gettimeofday( &(reportstruct->packetTime), NULL );
+                    gettime_monotonic( &(reportstruct->packetTime) );
                     CloseReport( exist->server->reporthdr, reportstruct );
         
                     if ( rc > (int) ( sizeof( UDP_datagram )
@@ -574,7 +816,14 @@ void Listener::UDPSingleServer( ) {
                     }
                     EndReport( exist->server->reporthdr );
                     exist->server->reporthdr = NULL;
-                    Iperf_delete( &(exist->server->peer), &clients );
+                    Iperf_delete( &server->peer, flows );
+                    if ( sharded ) {
+                        Mutex_Lock( &clients_mutex );
+                        Iperf_delete( &server->peer, &clients );
+                        sShardFlowsEnded++;
+                        done = (mCount && sShardFlowsEnded >= mSettings->mThreads);
+                        Mutex_Unlock( &clients_mutex );
+                    }
                 } else if ( rc > (int) ( sizeof( UDP_datagram )
                                                   + sizeof( server_hdr ) ) ) {
                     UDP_datagram *UDP_Hdr;
@@ -586,8 +835,14 @@ void Listener::UDPSingleServer( ) {
                 }
                 sendto( mSettings->mSock, mBuf, mSettings->mBufLen, 0,
                         (struct sockaddr*) &server->peer, server->size_peer);
+                if ( done ) {
+                    break;
+                }
             }
         }
+        if ( done ) {
+            break;
+        }
         if ( server->mSock == INVALID_SOCKET ) {
             break;
         }
@@ -612,13 +867,16 @@ void Listener::UDPSingleServer( ) {
         if ( client ) {
             if ( !SockAddr_Hostare_Equal( (sockaddr*) &mSettings->peer, 
                                           (sockaddr*) &server->peer ) ) {
-                // Not allowed try again
-                connect( mSettings->mSock, 
-                         (sockaddr*) &server->peer, 
-                         server->size_peer );
-                close( mSettings->mSock );
-                mSettings->mSock = -1; 
-                Listen( );
+                // Not allowed try again, a shard keeps its place
+                // in the SO_REUSEPORT group
+                if ( !sharded ) {
+                    connect( mSettings->mSock, 
+                             (sockaddr*) &server->peer, 
+                             server->size_peer );
+                    close( mSettings->mSock );
+                    mSettings->mSock = -1; 
+                    Listen( );
+                }
                 continue;
             }
         }
@@ -629,7 +887,10 @@ void Listener::UDPSingleServer( ) {
         listtemp->server = server;
         listtemp->next = NULL;
 
-        // See if we need to do summing
+        // See if we need to do summing, across all the shards
+        if ( sharded ) {
+            Mutex_Lock( &clients_mutex );
+        }
         exist = Iperf_hostpresent( &server->peer, clients); 
 
         if ( exist != NULL ) {
@@ -646,7 +907,12 @@ void Listener::UDPSingleServer( ) {
         }
 
         // Store entry in connection list
-        Iperf_pushback( listtemp, &clients ); 
+        if ( sharded ) {
+            Iperf_ListEntry *global = new Iperf_ListEntry;
+            *global = *listtemp;
+            Iperf_pushback( global, &clients ); 
+        }
+        Iperf_pushback( listtemp, flows ); 
 
         tempSettings = NULL;
         if ( !isCompat( mSettings ) && !isMulticast( mSettings ) ) {
@@ -667,7 +933,12 @@ void Listener::UDPSingleServer( ) {
                 server->runNext =  tempSettings;
             }
         }
+        // the lock also keeps the shards from adding
+        // to a client's sum at the same time
         server->reporthdr = InitReport( server );
+        if ( sharded ) {
+            Mutex_Unlock( &clients_mutex );
+        }
 
         // Prep for next connection
         if ( !isSingleClient( mSettings ) ) {
@@ -675,12 +946,83 @@ void Listener::UDPSingleServer( ) {
         }
         Settings_Copy( mSettings, &server );
         server->mThreadMode = kMode_Server;
-    } while ( !sInterupted && (!mCount || ( mCount && mClients > 0 )) );
-    Mutex_Unlock( &clients_mutex );
+        // a shard reads its flows to their end, so it
+        // counts the flows that ended rather than began
+    } while ( !sInterupted && (!mCount || sharded || ( mCount && mClients > 0 )) );
+    if ( !sharded ) {
+        Mutex_Unlock( &clients_mutex );
+    }
 
     Settings_Destroy( server );
 }
 
+/* ------------------------------------------------------------------- 
+ * Receive the next datagram for UDPSingleServer into mBuf, its sender
+ * into server->peer and its arrival time into arrived. With --udp-batch
+ * recvmmsg() fetches up to mBatchSize datagrams at a time, from any
+ * of the clients, and each call hands out the next of them.
+ * ------------------------------------------------------------------- */ 
+
+int Listener::RecvFrom( struct timespec *arrived ) {
+    int rc;
+
+#ifdef HAVE_RECVMMSG
+    if ( mSettings->mBatchSize > 1 ) {
+        int batch = mSettings->mBatchSize;
+        int i;
+
+        if ( mBatchMsgs == NULL ) {
+            mBatchBufs = BufferPool_Get( (size_t) batch * mSettings->mBufLen );
+            mBatchMsgs = new struct mmsghdr[ batch ];
+            mBatchIov = new struct iovec[ batch ];
+            mBatchPeers = new iperf_sockaddr[ batch ];
+            memset( mBatchMsgs, 0, batch * sizeof(struct mmsghdr) );
+            for ( i = 0; i < batch; i++ ) {
+                mBatchIov[i].iov_base = mBatchBufs + i * mSettings->mBufLen;
+                mBatchIov[i].iov_len = mSettings->mBufLen;
+                mBatchMsgs[i].msg_hdr.msg_iov = &mBatchIov[i];
+                mBatchMsgs[i].msg_hdr.msg_iovlen = 1;
+                mBatchMsgs[i].msg_hdr.msg_name = &mBatchPeers[i];
+            }
+        }
+        if ( mBatchNext == mBatchCount ) {
+            for ( i = 0; i < batch; i++ ) {
+                mBatchMsgs[i].msg_hdr.msg_namelen = sizeof(iperf_sockaddr);
+            }
+            // block for the first datagram, then take what else is queued
+            rc = recvmmsg( mSettings->mSock, mBatchMsgs, batch, MSG_WAITFORONE, NULL );
+            if ( rc < 0 && errno != ENOSYS ) {
+                return rc;
+            }
+            if ( rc < 0 ) {
+                // no recvmmsg() in this kernel
+                mSettings->mBatchSize = 1;
+                rc = 0;
+            }
+            mBatchCount = rc;
+            mBatchNext = 0;
+            gettime_monotonic( &mBatchTime );
+        }
+        if ( mBatchNext < mBatchCount ) {
+            struct msghdr *msg = &mBatchMsgs[mBatchNext].msg_hdr;
+            rc = mBatchMsgs[mBatchNext].msg_len;
+            // the loop reads the datagram and its headers from mBuf
+            memcpy( mBuf, mBatchIov[mBatchNext].iov_base, rc );
+            memcpy( &server->peer, msg->msg_name, msg->msg_namelen );
+            server->size_peer = msg->msg_namelen;
+            *arrived = mBatchTime;
+            mBatchNext++;
+            return rc;
+        }
+    }
+#endif
+    server->size_peer = sizeof( iperf_sockaddr );
+    rc = recvfrom( mSettings->mSock, mBuf, mSettings->mBufLen, 0, 
+                   (struct sockaddr*) &server->peer, &server->size_peer );
+    gettime_monotonic( arrived );
+    return rc;
+}
+
 /* -------------------------------------------------------------------- 
  * Run the server as a daemon  
  * --------------------------------------------------------------------*/ 
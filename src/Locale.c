@@ -92,11 +92,26 @@ Client/Server:\n\
   -M, --mss       #        set TCP maximum segment size (MTU - 40 bytes)\n\
   -N, --nodelay            set TCP no delay, disabling Nagle's Algorithm\n\
   -V, --IPv6Version        Set the domain to IPv6\n\
+      --udp-batch #        for UDP, send or receive # datagrams per system call\n\
+      --io-uring           send or receive through io_uring (Linux only)\n\
+      --affinity  <cpus>   pin stream and server threads round-robin to\n\
+                           <cpus>, e.g. 0-3,8, or rr for every CPU\n\
+      --reporter-affinity <cpus>  pin the reporter thread to <cpus>\n\
+      --hugepages          back the data buffers with huge pages\n\
+      --verify             send checksummed data and check it on receipt\n\
 \n\
 Server specific:\n\
   -s, --server             run in server mode\n\
   -U, --single_udp         run in single threaded UDP mode\n\
-  -D, --daemon             run the server as a daemon\n"
+  -D, --daemon             run the server as a daemon\n\
+      --udp-gro            for UDP, let the kernel coalesce datagrams (UDP_GRO)\n\
+      --rx-timestamps      for UDP, time datagrams by the kernel's receive\n\
+                           stamps and report the wait to be read\n\
+      --workers   #        serve TCP clients from # threads, each with an\n\
+                           event loop (epoll), and UDP from # SO_REUSEPORT\n\
+                           sockets, a thread each, 0 for one per CPU\n\
+      --reuseport-cpu      with UDP --workers, read each datagram on the\n\
+                           socket of the CPU that received it\n"
 #ifdef WIN32
 "  -R, --remove             remove service in win32\n"
 #endif
@@ -105,8 +120,8 @@ Server specific:\n\
 const char usage_long2[] = "\
 \n\
 Client specific:\n\
-  -b, --bandwidth #[KM]    for UDP, bandwidth to send at in bits/sec\n\
-                           (default 1 Mbit/sec, implies -u)\n\
+  -b, --bandwidth #[KM]    bandwidth to send at in bits/sec per stream\n\
+                           (UDP default 1 Mbit/sec, TCP default unlimited)\n\
   -c, --client    <host>   run in client mode, connecting to <host>\n\
   -d, --dualtest           Do a bidirectional test simultaneously\n\
   -n, --num       #[KM]    number of bytes to transmit (instead of -t)\n\
@@ -117,6 +132,30 @@ Client specific:\n\
   -L, --listenport #       port to recieve bidirectional tests back on\n\
   -P, --parallel  #        number of parallel client threads to run\n\
   -T, --ttl       #        time-to-live, for multicast (default 1)\n\
+      --delay-spin #       usecs to spin rather than sleep before each -b\n\
+                           deadline (default 100)\n\
+      --isochronous #[:n]  for UDP, send # frames per second, each a burst of\n\
+                           n datagrams (default 1), instead of a -b rate\n\
+      --gap-dist  <dist>   for UDP, gaps between -b sends: const, exp (Poisson),\n\
+                           uniform or pareto[:shape], same mean rate\n\
+      --seed      #        random seed for --gap-dist (default: the time)\n\
+      --size-mix  <mix>    sizes of the writes, imix or a list of <size>[:<weight>]\n\
+                           e.g. 64:7,594:4,1518:1\n\
+      --trace     <file>   for UDP, replay the packet sizes and times of a\n\
+                           pcap or a text file of \"<secs> <bytes>\" lines\n\
+      --workers   #        run the -P streams from # threads, each driving\n\
+                           its streams from an event loop (epoll), 0 for\n\
+                           one per CPU\n\
+      --fq-rate   #[KM]    have the kernel pace the stream at # bits/sec\n\
+                           (SO_MAX_PACING_RATE), replacing the -b pacer\n\
+      --burst-size #[KM]   bytes the -b pacer may send back-to-back\n\
+                           (default 10 msec worth, at least one write)\n\
+      --udp-gso            for UDP, let the kernel segment writes (UDP_SEGMENT)\n\
+      --tx-timestamps      for UDP, report the time datagrams take through the\n\
+                           send stack from kernel transmit stamps\n\
+      --zerocopy           for TCP, send without copying (MSG_ZEROCOPY)\n\
+      --sendfile           for TCP, send the -F file with sendfile()\n\
+      --file-loop          restart the -F file at its end until the test is over\n\
   -Z, --linux-congestion <algo>  set TCP congestion control algorithm (Linux only)\n\
 \n\
 Miscellaneous:\n\
@@ -170,9 +209,73 @@ const char join_multicast[] =
 const char client_datagram_size[] =
 "Sending %d byte datagrams\n";
 
+const char client_datagram_batch[] =
+"Sending %d datagrams per system call\n";
+
+const char client_datagram_gso[] =
+"Sending %d datagrams per UDP GSO segmented write\n";
+
 const char server_datagram_size[] =
 "Receiving %d byte datagrams\n";
 
+const char server_datagram_batch[] =
+"Receiving up to %d datagrams per system call\n";
+
+const char server_datagram_gro[] =
+"Receiving datagrams coalesced by UDP GRO\n";
+
+const char server_reuseport[] =
+"Receiving on %d SO_REUSEPORT sockets, a thread each, flows spread by %s\n";
+
+const char server_rx_stamps[] =
+"Timing datagrams by kernel receive timestamps\n";
+
+const char client_tx_stamps[] =
+"Timing datagrams through the send stack by kernel transmit timestamps\n";
+
+const char client_rate_limit[] =
+"Rate limited to %ss/sec per stream\n";
+
+const char client_isochronous[] =
+"Isochronous: %d datagram frames at %.2f frames/sec\n";
+
+const char client_size_mix[] =
+"Write sizes drawn from the mix (size:weight) %s\n";
+
+const char client_trace[] =
+"Replaying packet sizes and times from %s\n";
+
+const char client_gap_dist[] =
+"Inter-departure gaps %s, seed %u\n";
+
+const char* gap_dist_name[] = {
+    "constant",
+    "exponential",
+    "uniform",
+    "Pareto"
+};
+
+const char client_fq_pacing[] =
+"Kernel pacing at %ss/sec (SO_MAX_PACING_RATE)\n";
+
+const char thread_affinity[] =
+"Stream threads pinned round-robin to CPUs %s (NUMA node %s)\n";
+
+const char reporter_affinity[] =
+"Reporter thread pinned to CPUs %s (NUMA node %s)\n";
+
+const char buffer_hugepages[] =
+"Data buffers on %s huge pages\n";
+
+const char* hugepages_name[] = {
+    "no",
+    "transparent",
+    "reserved"
+};
+
+const char payload_verify[] =
+"Payload verified with CRC32C computed %s\n";
+
 const char tcp_window_size[] =
 "TCP window size";
 
@@ -232,6 +335,33 @@ const char report_mss[] =
 const char report_datagrams[] =
 "[%3d] Sent %d datagrams\n";
 
+const char report_target_rate[] =
+"[%3d] %4.1f-%4.1f sec  %ss/sec target, %.1f%% achieved\n";
+
+const char report_delays[] =
+"[%3d] %d pacing delays, %.1f usec late on average, %.1f usec max\n";
+
+const char report_cpu[] =
+"[%3d] sender thread used %.1f%% CPU\n";
+
+const char report_frames[] =
+"[%3d] %4.1f-%4.1f sec  %d frames, %d with loss, latency %.3f ms avg %.3f ms max\n";
+
+const char report_rx_stamps[] =
+"[%3d] %4.1f-%4.1f sec  %d datagrams stamped, read %.3f ms avg %.3f ms max after arrival\n";
+
+const char report_tx_stamps[] =
+"[%3d] %4.1f-%4.1f sec  %d datagrams stamped, sent %.1f us avg %.1f us p50 %.1f us p99 %.1f us max after write\n";
+
+const char report_verify[] =
+"[%3d] %4.1f-%4.1f sec  %d blocks verified, %d corrupt\n";
+
+const char report_zerocopy[] =
+"[%3d] %d sends completed zero-copy, %d copied by the kernel\n";
+
+const char report_size_class[] =
+"[%3d] %6d byte writes: %9d, %ss, %4.1f%% of the bytes\n";
+
 const char report_sum_datagrams[] =
 "[SUM] Sent %d datagrams\n";
 
@@ -309,15 +439,15 @@ const char report_interval_small[] =
 const char warn_invalid_server_option[] =
 "WARNING: option -%c is not valid for server mode\n";
 
+const char warn_invalid_server_long_option[] =
+"WARNING: option --%s is not valid for server mode\n";
+
 const char warn_invalid_client_option[] =
 "WARNING: option -%c is not valid for client mode\n";
 
 const char warn_invalid_compatibility_option[] =
 "WARNING: option -%c is not valid in compatibility mode\n";
 
-const char warn_implied_udp[] =
-"WARNING: option -%c implies udp testing\n";
-
 const char warn_implied_compatibility[] =
 "WARNING: option -%c has implied compatibility mode\n";
 
@@ -330,6 +460,85 @@ const char warn_invalid_single_threaded[] =
 const char warn_invalid_report_style[] =
 "WARNING: unknown reporting style \"%s\", switching to default\n";
 
+const char warn_batch_large[] =
+"WARNING: batch of %d datagrams too large, reducing to %d\n";
+
+const char warn_gso_unsupported[] =
+"WARNING: UDP GSO not available (%s), sending datagrams individually\n";
+
+const char warn_rxstamps_unsupported[] =
+"WARNING: kernel receive timestamps not available (%s), timing datagrams as read\n";
+
+const char warn_txstamps_unsupported[] =
+"WARNING: kernel transmit timestamps not available (%s), not timing the send stack\n";
+
+const char warn_gro_unsupported[] =
+"WARNING: UDP GRO not available (%s), receiving datagrams individually\n";
+
+const char warn_invalid_isochronous[] =
+"WARNING: --isochronous needs <frames per second>[:<datagrams per frame>], not %s\n";
+
+const char warn_isochronous_unsupported[] =
+"WARNING: --isochronous needs UDP, no -C and room for its headers in -l\n";
+
+const char warn_trace_unsupported[] =
+"WARNING: --trace replays UDP datagrams and needs -u, sending as usual\n";
+
+const char warn_trace_open[] =
+"WARNING: unable to read the trace %s, sending as usual\n";
+
+const char warn_trace_record[] =
+"WARNING: skipping an unreadable trace line after record %d\n";
+
+const char warn_trace_len[] =
+"WARNING: --trace datagram of %d bytes exceeds -l %d, run the server with -l %d\n";
+
+const char warn_trace_max[] =
+"WARNING: --trace datagram of %d bytes sent as the largest UDP payload, %d\n";
+
+const char warn_invalid_size_mix[] =
+"WARNING: unknown --size-mix %s, use imix or up to %d <size>[:<weight>]\n";
+
+const char warn_size_mix_len[] =
+"WARNING: --size-mix datagrams of up to %d bytes exceed -l %d, run the server with -l %d\n";
+
+const char warn_invalid_gap_dist[] =
+"WARNING: unknown --gap-dist %s, use const, exp, uniform or pareto[:shape]\n";
+
+const char warn_workers_options[] =
+"WARNING: --workers streams send plain writes, ignoring --udp-batch, --udp-gso,\n\
+--zerocopy, -F, --sendfile, --isochronous and --trace\n";
+
+const char warn_workers_unsupported[] =
+"WARNING: --workers needs epoll and threads, running a thread per stream\n";
+
+const char warn_workers_udp[] =
+"WARNING: UDP --workers needs SO_REUSEPORT and unicast, reading one socket\n";
+
+const char warn_reuseport_cpu[] =
+"WARNING: --reuseport-cpu failed (%s), flows spread by address hash\n";
+
+const char warn_pacing_unsupported[] =
+"WARNING: kernel pacing not available (%s)\n";
+
+const char warn_verify_unsupported[] =
+"WARNING: --verify checks generated data, not used with -F, -I, --isochronous or --trace\n";
+
+const char warn_iouring_unsupported[] =
+"WARNING: io_uring not available (%s), using plain reads and writes\n";
+
+const char warn_invalid_affinity[] =
+"WARNING: ignoring the CPU list '%s', expected e.g. 0-3,8 or rr\n";
+
+const char warn_affinity_failed[] =
+"WARNING: could not pin a %s thread (%s)\n";
+
+const char warn_sendfile_failed[] =
+"WARNING: sendfile failed (%s), reading the file instead\n";
+
+const char warn_zerocopy_unsupported[] =
+"WARNING: zero-copy send not available (%s), copying instead\n";
+
 const char warn_invalid_report[] =
 "WARNING: unknown reporting type \"%c\", ignored\n valid options are:\n\t exclude: C(connection) D(data) M(multicast) S(settings) V(server) report\n\n";
 
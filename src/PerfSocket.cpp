@@ -77,6 +77,7 @@
 #include "PerfSocket.hpp"
 #include "SocketAddr.h"
 #include "util.h"
+#include "Locale.h"
 
 /* -------------------------------------------------------------------
  * Set socket options before the listen() or connect() calls.
@@ -128,6 +129,46 @@ void SetSocketOptions( thread_Settings *inSettings ) {
 #endif
     }
 
+    // have the kernel (fq qdisc or TCP internal pacing) pace the stream
+    if ( inSettings->mFQPacingRate > 0 ) {
+#ifdef SO_MAX_PACING_RATE
+        int rc;
+        max_size_t rate = inSettings->mFQPacingRate / 8;
+        if ( rate > 0xFFFFFFFFu ) {
+            // newer kernels take a 64 bit rate
+            uint64_t rate64 = rate;
+            rc = setsockopt( inSettings->mSock, SOL_SOCKET, SO_MAX_PACING_RATE,
+                             (char*) &rate64, sizeof(rate64) );
+        } else {
+            u_int32_t rate32 = (u_int32_t) rate;
+            rc = setsockopt( inSettings->mSock, SOL_SOCKET, SO_MAX_PACING_RATE,
+                             (char*) &rate32, sizeof(rate32) );
+        }
+        if ( rc == SOCKET_ERROR ) {
+            fprintf( stderr, warn_pacing_unsupported, strerror( errno ) );
+            inSettings->mFQPacingRate = 0;
+        }
+#else
+        fprintf( stderr, warn_pacing_unsupported, "SO_MAX_PACING_RATE undefined" );
+        inSettings->mFQPacingRate = 0;
+#endif
+    }
+
+    // let the kernel split each write into mBufLen sized datagrams
+    if ( isUDP( inSettings ) && isUDPGSO( inSettings ) ) {
+#ifdef UDP_SEGMENT
+        int gso = inSettings->mBufLen;
+        int rc = setsockopt( inSettings->mSock, IPPROTO_UDP, UDP_SEGMENT,
+                             (char*) &gso, sizeof(gso) );
+        if ( rc == SOCKET_ERROR ) {
+            fprintf( stderr, warn_gso_unsupported, strerror( errno ) );
+            unsetUDPGSO( inSettings );
+        }
+#else
+        fprintf( stderr, warn_gso_unsupported, "UDP_SEGMENT undefined" );
+        unsetUDPGSO( inSettings );
+#endif
+    }
 
 #ifdef IP_TOS
 
@@ -145,6 +186,25 @@ void SetSocketOptions( thread_Settings *inSettings ) {
         // set the TCP maximum segment size
         setsock_tcp_mss( inSettings->mSock, inSettings->mMSS );
 
+#ifdef HAVE_MSG_ZEROCOPY
+
+        // allow MSG_ZEROCOPY sends, see Client::RunTCP
+        if ( isZeroCopy( inSettings ) ) {
+            int zerocopy = 1;
+            int rc = setsockopt( inSettings->mSock, SOL_SOCKET, SO_ZEROCOPY,
+                                 (char*) &zerocopy, sizeof(zerocopy) );
+            if ( rc == SOCKET_ERROR ) {
+                fprintf( stderr, warn_zerocopy_unsupported, strerror( errno ) );
+                unsetZeroCopy( inSettings );
+            }
+        }
+#else
+        if ( isZeroCopy( inSettings ) ) {
+            fprintf( stderr, warn_zerocopy_unsupported, "MSG_ZEROCOPY undefined" );
+            unsetZeroCopy( inSettings );
+        }
+#endif
+
 #ifdef TCP_NODELAY
 
         // set TCP nodelay option
@@ -58,6 +58,9 @@
 #include "Locale.h"
 #include "PerfSocket.hpp"
 #include "SocketAddr.h"
+#include "Affinity.h"
+#include "BufferPool.h"
+#include "Verify.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -80,6 +83,15 @@ void reporter_printstats( Transfer_Info *stats ) {
         printf( report_bw_format, stats->transferID, 
                 stats->startTime, stats->endTime, 
                 buffer, &buffer[sizeof(buffer)/2] );
+        if ( stats->mTargetRate > 0 ) {
+            // compare the achieved rate to the one the pacer aimed for
+            char target[32];
+            byte_snprintf( target, sizeof(target), 
+                           stats->mTargetRate / 8.0, stats->mFormat );
+            printf( report_target_rate, stats->transferID, 
+                    stats->startTime, stats->endTime, target,
+                    (100.0 * 8.0 * speed) / stats->mTargetRate );
+        }
     } else {
         // UDP Reporting
 		double errRate = (stats->cntDatagrams==0) ? 0 : (100.0 * stats->cntError) / stats->cntDatagrams;
@@ -98,10 +110,59 @@ void reporter_printstats( Transfer_Info *stats ) {
                     stats->transferID, stats->startTime, 
                     stats->endTime, stats->cntOutofOrder );
         }
+        if ( stats->cntFrames + stats->cntFramesLost > 0 ) {
+            printf( report_frames,
+                    stats->transferID, stats->startTime, stats->endTime,
+                    stats->cntFrames + stats->cntFramesLost, stats->cntFramesLost,
+                    stats->frameLatency * 1e3, stats->frameLatencyMax * 1e3 );
+        }
+        if ( stats->cntStamped > 0 ) {
+            printf( report_rx_stamps,
+                    stats->transferID, stats->startTime, stats->endTime,
+                    stats->cntStamped, stats->appDelay * 1e3, 
+                    stats->appDelayMax * 1e3 );
+        }
+    }
+    if ( stats->cntVerified + stats->cntCorrupt > 0 ) {
+        printf( report_verify, stats->transferID, stats->startTime,
+                stats->endTime, stats->cntVerified, stats->cntCorrupt );
+    }
+    if ( stats->cntTxStamped > 0 ) {
+        printf( report_tx_stamps, stats->transferID, stats->startTime,
+                stats->endTime, stats->cntTxStamped, stats->txDelay * 1e6,
+                stats->txDelayP50 * 1e6, stats->txDelayP99 * 1e6, 
+                stats->txDelayMax * 1e6 );
     }
     if ( stats->free == 1 && stats->mUDP == (char)kMode_Client ) {
         printf( report_datagrams, stats->transferID, stats->cntDatagrams ); 
     }
+    if ( stats->free == 1 && stats->cntDelays > 0 ) {
+        printf( report_delays, stats->transferID, stats->cntDelays,
+                stats->delayLate / stats->cntDelays, stats->delayLateMax );
+        if ( stats->cpuTime >= 0 && stats->endTime > stats->startTime ) {
+            printf( report_cpu, stats->transferID,
+                    100.0 * stats->cpuTime / (stats->endTime - stats->startTime) );
+        }
+    }
+    if ( stats->free == 1 && stats->cntZeroCopy + stats->cntCopied > 0 ) {
+        printf( report_zerocopy, stats->transferID,
+                stats->cntZeroCopy, stats->cntCopied );
+    }
+    if ( stats->free == 1 && stats->cntSizeClasses > 0 ) {
+        // bytes and writes of each --size-mix size
+        int i;
+        max_size_t total = 0;
+        for ( i = 0; i < stats->cntSizeClasses; i++ ) {
+            total += stats->sizeBytes[i];
+        }
+        for ( i = 0; i < stats->cntSizeClasses; i++ ) {
+            byte_snprintf( buffer, sizeof(buffer), (double) stats->sizeBytes[i],
+                           toupper( stats->mFormat));
+            printf( report_size_class, stats->transferID, stats->sizeClass[i],
+                    stats->cntSizeWrites[i], buffer, 
+                    (total > 0 ? 100.0 * stats->sizeBytes[i] / total : 0) );
+        }
+    }
 }
 
 
@@ -155,6 +216,40 @@ void reporter_serverstats( Connection_Info *nused, Transfer_Info *stats ) {
 /*
  * Report the client or listener Settings in default style
  */
+/*
+ * Print a --affinity or --reporter-affinity list of CPUs
+ * with the NUMA nodes they belong to
+ */
+static void reporter_printaffinity( const char *format, int *cpus, int count ) {
+    char cpulist[256];
+    char nodelist[64];
+    int nodes[AFFINITY_MAX_CPUS];
+    int i, j, node, nodeCount = 0;
+
+    // distinct nodes, in order
+    for ( i = 0; i < count; i++ ) {
+        node = Affinity_Node( cpus[i] );
+        if ( node < 0 ) {
+            continue;
+        }
+        for ( j = nodeCount; j > 0 && nodes[j-1] > node; j-- ) {
+        }
+        if ( j > 0 && nodes[j-1] == node ) {
+            continue;
+        }
+        memmove( nodes + j + 1, nodes + j, (nodeCount - j) * sizeof(int) );
+        nodes[j] = node;
+        nodeCount++;
+    }
+    Affinity_Format( cpus, count, cpulist, sizeof(cpulist) );
+    if ( nodeCount > 0 ) {
+        Affinity_Format( nodes, nodeCount, nodelist, sizeof(nodelist) );
+    } else {
+        strcpy( nodelist, "unknown" );
+    }
+    printf( format, cpulist, nodelist );
+}
+
 void reporter_reportsettings( ReporterData *data ) {
     int win, win_requested;
 
@@ -184,10 +279,72 @@ void reporter_reportsettings( ReporterData *data ) {
         printf( (data->mThreadMode == kMode_Listener ? 
                                    server_datagram_size : client_datagram_size),
                 data->mBufLen );
+        if ( data->mThreadMode != kMode_Listener && data->mBatchSize > 1 ) {
+            printf( (isUDPGSO( data ) ?
+                     client_datagram_gso : client_datagram_batch),
+                    data->mBatchSize );
+        } else if ( data->mBatchSize > 1 ) {
+            printf( server_datagram_batch, data->mBatchSize );
+        }
+        if ( data->mThreadMode == kMode_Listener && data->mWorkers > 0 ) {
+            printf( server_reuseport, data->mWorkers,
+                    (data->mReusePortCPU ? "receiving CPU" : "address hash") );
+        }
+        if ( data->mThreadMode == kMode_Listener && data->mUDPGRO ) {
+            printf( server_datagram_gro );
+        }
+        if ( data->mThreadMode == kMode_Listener && data->mRxStamps ) {
+            printf( server_rx_stamps );
+        }
+        if ( data->mThreadMode != kMode_Listener && data->mTxStamps ) {
+            printf( client_tx_stamps );
+        }
         if ( SockAddr_isMulticast( &data->connection.peer ) ) {
             printf( multicast_ttl, data->info.mTTL);
         }
     }
+    if ( data->mThreadMode != kMode_Listener && isTrace( data ) ) {
+        printf( client_trace, data->mTraceName );
+    } else if ( data->mThreadMode != kMode_Listener && isIsochronous( data ) ) {
+        printf( client_isochronous, data->mFrameBurst, data->mFPS );
+    } else if ( data->mThreadMode != kMode_Listener && data->mUDPRate > 0 &&
+         data->mFQPacingRate == 0 ) {
+        byte_snprintf( buffer, sizeof(buffer), data->mUDPRate / 8.0,
+                       tolower( data->info.mFormat));
+        printf( client_rate_limit, buffer );
+        if ( isUDP( data ) && data->mGapDist != kGap_Constant ) {
+            printf( client_gap_dist, gap_dist_name[data->mGapDist], data->mSeed );
+        }
+    }
+    if ( data->mThreadMode != kMode_Listener && data->mSizeCount > 0 ) {
+        // sizes of at most 10 digits, with their weights
+        int i, len = 0;
+        char mix[MAX_SIZE_CLASSES * 24];
+        for ( i = 0; i < data->mSizeCount; i++ ) {
+            len += snprintf( mix + len, sizeof(mix) - len, "%s%d:%d",
+                             (i > 0 ? "," : ""), data->mSizes[i],
+                             data->mSizeWeights[i] );
+        }
+        printf( client_size_mix, mix );
+    }
+    if ( data->mThreadMode != kMode_Listener && data->mFQPacingRate > 0 ) {
+        byte_snprintf( buffer, sizeof(buffer), data->mFQPacingRate / 8.0,
+                       tolower( data->info.mFormat));
+        printf( client_fq_pacing, buffer );
+    }
+    if ( data->mCPUCount > 0 ) {
+        reporter_printaffinity( thread_affinity, data->mCPUs, data->mCPUCount );
+    }
+    if ( data->mReporterCPUCount > 0 ) {
+        reporter_printaffinity( reporter_affinity, data->mReporterCPUs, 
+                                data->mReporterCPUCount );
+    }
+    if ( data->mHugePages ) {
+        printf( buffer_hugepages, hugepages_name[ BufferPool_HugePages() ] );
+    }
+    if ( data->mVerify ) {
+        printf( payload_verify, (Verify_Hardware() ? "by the CPU" : "in software") );
+    }
     byte_snprintf( buffer, sizeof(buffer), win,
                    toupper( data->info.mFormat));
     printf( "%s: %s", (isUDP( data ) ? 
@@ -57,6 +57,7 @@
 #include "Locale.h"
 #include "PerfSocket.hpp"
 #include "SocketAddr.h"
+#include "Affinity.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -116,6 +117,9 @@ extern Condition ReportCond;
 int reporter_process_report ( ReportHeader *report );
 void process_report ( ReportHeader *report );
 int reporter_handle_packet( ReportHeader *report );
+void reporter_handle_frame( ReporterData *data, ReportStruct *packet );
+void reporter_handle_txdelay( ReporterData *data, double delay );
+double reporter_delay_percentile( int *bins, int count, double fraction, double max );
 int reporter_condprintstats( ReporterData *stats, MultiHeader *multireport, int force );
 int reporter_print( ReporterData *stats, int type, int end );
 void PrintMSS( ReporterData *stats );
@@ -148,10 +152,10 @@ MultiHeader* InitMulti( thread_Settings *agent, int inID ) {
                 }
                 data->type = TRANSFER_REPORT;
                 if ( agent->mInterval != 0.0 ) {
-                    struct timeval *interval = &data->intervalTime;
+                    struct timespec *interval = &data->intervalTime;
                     interval->tv_sec = (long) agent->mInterval;
-                    interval->tv_usec = (long) ((agent->mInterval - interval->tv_sec) 
-                                                * rMillion);
+                    interval->tv_nsec = (long) ((agent->mInterval - interval->tv_sec) 
+                                                * rBillion);
                 }
                 data->mHost = agent->mHost;
                 data->mLocalhost = agent->mLocalhost;
@@ -184,20 +188,28 @@ MultiHeader* InitMulti( thread_Settings *agent, int inID ) {
 }
 
 /*
- * BarrierClient allows for multiple stream clients to be syncronized
+ * BarrierStreams waits for all the streams of a group, a --workers
+ * thread arrives once for all of the streams it drives
  */
-void BarrierClient( ReportHeader *agent ) {
-    Condition_Lock(agent->multireport->barrier);
-    agent->multireport->threads--;
-    if ( agent->multireport->threads == 0 ) {
+void BarrierStreams( MultiHeader *multihdr, int streams ) {
+    Condition_Lock(multihdr->barrier);
+    multihdr->threads -= streams;
+    if ( multihdr->threads == 0 ) {
         // last one set time and wake up everyone
-        gettimeofday( &(agent->multireport->startTime), NULL );
-        Condition_Broadcast( &agent->multireport->barrier );
+        gettime_monotonic( &(multihdr->startTime) );
+        Condition_Broadcast( &multihdr->barrier );
     } else {
-        Condition_Wait( &agent->multireport->barrier );
+        Condition_Wait( &multihdr->barrier );
     }
-    agent->multireport->threads++;
-    Condition_Unlock( agent->multireport->barrier );
+    multihdr->threads += streams;
+    Condition_Unlock( multihdr->barrier );
+}
+
+/*
+ * BarrierClient allows for multiple stream clients to be syncronized
+ */
+void BarrierClient( ReportHeader *agent ) {
+    BarrierStreams( agent->multireport, 1 );
     agent->report.startTime = agent->multireport->startTime;
     agent->report.nextTime = agent->report.startTime;
     TimeAdd( agent->report.nextTime, agent->report.intervalTime );
@@ -218,6 +230,12 @@ ReportHeader* InitReport( thread_Settings *agent ) {
         reporthdr = malloc( sizeof(ReportHeader) +
                             NUM_REPORT_STRUCTS * sizeof(ReportStruct) );
         if ( reporthdr != NULL ) {
+            // a pinned stream keeps its ring on its own NUMA node
+            if ( agent->mCPU >= 0 ) {
+                Affinity_Place( reporthdr, sizeof(ReportHeader) + 
+                                NUM_REPORT_STRUCTS * sizeof(ReportStruct),
+                                Affinity_Node( agent->mCPU ) );
+            }
             // Only need to make sure the headers are clean
             memset( reporthdr, 0, sizeof(ReportHeader));
             reporthdr->data = (ReportStruct*)(reporthdr+1);
@@ -229,10 +247,10 @@ ReportHeader* InitReport( thread_Settings *agent ) {
                                                           : -1);
             data->type = TRANSFER_REPORT;
             if ( agent->mInterval != 0.0 ) {
-                struct timeval *interval = &data->intervalTime;
+                struct timespec *interval = &data->intervalTime;
                 interval->tv_sec = (long) agent->mInterval;
-                interval->tv_usec = (long) ((agent->mInterval - interval->tv_sec) 
-                                            * rMillion);
+                interval->tv_nsec = (long) ((agent->mInterval - interval->tv_sec) 
+                                            * rBillion);
             }
             data->mHost = agent->mHost;
             data->mLocalhost = agent->mLocalhost;
@@ -241,12 +259,29 @@ ReportHeader* InitReport( thread_Settings *agent ) {
             data->mTCPWin = agent->mTCPWin;
             data->flags = agent->flags;
             data->mThreadMode = agent->mThreadMode;
+            data->mVerify = agent->mVerify;
+            data->mRxStamps = agent->mRxStamps;
+            data->mTxStamps = agent->mTxStamps;
             data->mode = agent->mReportMode;
             data->info.mFormat = agent->mFormat;
             data->info.mTTL = agent->mTTL;
             if ( isUDP( agent ) ) {
                 reporthdr->report.info.mUDP = (char)agent->mThreadMode;
             }
+            if ( agent->mThreadMode == kMode_Client ) {
+                data->info.mTargetRate = agent->mUDPRate;
+                if ( isIsochronous( agent ) ) {
+                    data->info.mTargetRate = (max_size_t) (agent->mFPS * 
+                              agent->mFrameBurst * agent->mBufLen * 8);
+                }
+                if ( isTrace( agent ) ) {
+                    // the trace sets the rate
+                    data->info.mTargetRate = 0;
+                }
+            }
+            if ( agent->mThreadMode == kMode_Client && agent->mFQPacingRate > 0 ) {
+                data->info.mTargetRate = agent->mFQPacingRate;
+            }
         } else {
             FAIL(1, "Out of Memory!!\n", agent);
         }
@@ -284,6 +319,12 @@ ReportHeader* InitReport( thread_Settings *agent ) {
          * Update the ReportRoot to include this report.
          */
         if ( reporthdr->report.mThreadMode == kMode_Client &&
+             reporthdr->multireport != NULL && isWorker( agent ) ) {
+            // the --workers thread already waited at the barrier
+            reporthdr->report.startTime = reporthdr->multireport->startTime;
+            reporthdr->report.nextTime = reporthdr->report.startTime;
+            TimeAdd( reporthdr->report.nextTime, reporthdr->report.intervalTime );
+        } else if ( reporthdr->report.mThreadMode == kMode_Client &&
              reporthdr->multireport != NULL ) {
             // syncronize watches on my mark......
             BarrierClient( reporthdr );
@@ -291,12 +332,12 @@ ReportHeader* InitReport( thread_Settings *agent ) {
             if ( reporthdr->multireport != NULL && isMultipleReport( agent )) {
                 reporthdr->multireport->threads++;
                 if ( reporthdr->multireport->report->startTime.tv_sec == 0 ) {
-                    gettimeofday( &(reporthdr->multireport->report->startTime), NULL );
+                    gettime_monotonic( &(reporthdr->multireport->report->startTime) );
                 }
                 reporthdr->report.startTime = reporthdr->multireport->report->startTime;
             } else {
                 // set start time
-                gettimeofday( &(reporthdr->report.startTime), NULL );
+                gettime_monotonic( &(reporthdr->report.startTime) );
             }
             reporthdr->report.nextTime = reporthdr->report.startTime;
             TimeAdd( reporthdr->report.nextTime, reporthdr->report.intervalTime );
@@ -308,7 +349,7 @@ ReportHeader* InitReport( thread_Settings *agent ) {
         Condition_Unlock( ReportCond );
 #else
         // set start time
-        gettimeofday( &(reporthdr->report.startTime), NULL );
+        gettime_monotonic( &(reporthdr->report.startTime) );
         /*
          * Process the report in this thread
          */
@@ -368,6 +409,56 @@ void ReportPacket( ReportHeader* agent, ReportStruct *packet ) {
     }
 }
 
+/*
+ * ReportPacketBatch is ReportPacket for count packets at once. They
+ * go into the ring in as few copies as the free space allows, and
+ * the reporter is woken once for them all.
+ */
+void ReportPacketBatch( ReportHeader* agent, ReportStruct *packets, int count ) {
+    if ( agent != NULL ) {
+        while ( count > 0 ) {
+            int index = agent->reporterindex;
+            int room;
+            if ( agent->agentindex == NUM_REPORT_STRUCTS ) {
+                // Just need to make sure that reporter is not on the first
+                // item
+                while ( index == 0 ) {
+                    Condition_Signal( &ReportCond );
+                    thread_rest();
+                    index = agent->reporterindex;
+                }
+                agent->agentindex = 0;
+            }
+            // Need to make sure that reporter is not about to be "lapped"
+            while ( index - 1 == agent->agentindex ) {
+                Condition_Signal( &ReportCond );
+                thread_rest();
+                index = agent->reporterindex;
+            }
+            // free slots up to the reporter or to the end of the ring
+            room = ( index > agent->agentindex ? index - 1 : NUM_REPORT_STRUCTS ) 
+                   - agent->agentindex;
+            if ( room > count ) {
+                room = count;
+            }
+            memcpy( agent->data + agent->agentindex, packets, room * sizeof(ReportStruct) );
+
+            // Updating agentindex MUST be the last thing done
+            agent->agentindex += room;
+            packets += room;
+            count -= room;
+        }
+	if (threadSleeping)
+           Condition_Signal( &ReportCond );
+#ifndef HAVE_THREAD
+        /*
+         * Process the report in this thread
+         */
+        process_report ( agent );
+#endif 
+    }
+}
+
 /*
  * CloseReport is called by a transfer agent to finalize
  * the report and signal transfer is over.
@@ -447,11 +538,33 @@ void ReportSettings( thread_Settings *agent ) {
         
             data->mHost = agent->mHost;
             data->mLocalhost = agent->mLocalhost;
+            data->mTraceName = agent->mTraceName;
             data->mode = agent->mReportMode;
             data->type = SETTINGS_REPORT;
             data->mBufLen = agent->mBufLen;
             data->mMSS = agent->mMSS;
             data->mTCPWin = agent->mTCPWin;
+            data->mBatchSize = agent->mBatchSize;
+            data->mUDPRate = agent->mUDPRate;
+            data->mFQPacingRate = agent->mFQPacingRate;
+            data->mFPS = agent->mFPS;
+            data->mFrameBurst = agent->mFrameBurst;
+            data->mGapDist = agent->mGapDist;
+            data->mSeed = agent->mSeed;
+            data->mCPUs = agent->mCPUs;
+            data->mCPUCount = agent->mCPUCount;
+            data->mReporterCPUs = agent->mReporterCPUs;
+            data->mReporterCPUCount = agent->mReporterCPUCount;
+            data->mHugePages = agent->mHugePages;
+            data->mVerify = agent->mVerify;
+            data->mUDPGRO = agent->mUDPGRO;
+            data->mRxStamps = agent->mRxStamps;
+            data->mTxStamps = agent->mTxStamps;
+            data->mWorkers = agent->mWorkers;
+            data->mReusePortCPU = agent->mReusePortCPU;
+            data->mSizeCount = agent->mSizeCount;
+            memcpy( data->mSizes, agent->mSizes, sizeof(data->mSizes) );
+            memcpy( data->mSizeWeights, agent->mSizeWeights, sizeof(data->mSizeWeights) );
             data->flags = agent->flags;
             data->mThreadMode = agent->mThreadMode;
             data->mPort = agent->mPort;
@@ -559,6 +672,13 @@ void ReportServerUDP( thread_Settings *agent, server_hdr *server ) {
  * This function is the loop that the reporter thread processes
  */
 void reporter_spawn( thread_Settings *thread ) {
+    // --reporter-affinity
+    if ( thread->mReporterCPUCount > 0 ) {
+        int rc = Affinity_Pin( thread->mReporterCPUs, thread->mReporterCPUCount );
+        if ( rc != 0 ) {
+            fprintf( stderr, warn_affinity_failed, "reporter", strerror( rc ) );
+        }
+    }
     do {
         // This section allows for safe exiting with Ctrl-C
         Condition_Lock ( ReportCond );
@@ -702,12 +822,36 @@ int reporter_handle_packet( ReportHeader *reporthdr ) {
         finished = 1;
         if ( reporthdr->report.mThreadMode != kMode_Client ) {
             data->TotalLen += packet->packetLen;
+            // a frame still short of datagrams at the end was lossy
+            if ( data->frameID > 0 && data->frameCount < data->frameBurst ) {
+                data->cntFramesLost++;
+                data->frameID = 0;
+            }
         }
     } else {
         // update recieved amount and time
         data->packetTime = packet->packetTime;
         reporter_condprintstats( &reporthdr->report, reporthdr->multireport, finished );
         data->TotalLen += packet->packetLen;
+        if ( data->mVerify && data->mThreadMode != kMode_Client ) {
+            data->cntVerified += packet->verified;
+            data->cntCorrupt += packet->corrupt;
+        }
+        if ( data->mRxStamps && packet->appDelay >= 0 && 
+             data->mThreadMode != kMode_Client ) {
+            data->cntStamped++;
+            data->appDelay += packet->appDelay;
+            if ( packet->appDelay > data->appDelayMax ) {
+                data->appDelayMax = packet->appDelay;
+            }
+            if ( packet->appDelay > data->intervalAppDelayMax ) {
+                data->intervalAppDelayMax = packet->appDelay;
+            }
+        }
+        if ( data->mTxStamps && packet->txDelay >= 0 && 
+             data->mThreadMode == kMode_Client ) {
+            reporter_handle_txdelay( data, packet->txDelay );
+        }
         if ( packet->packetID != 0 ) {
 #ifdef USE_FIXPT
             /* reduce the floating point operation */
@@ -724,8 +868,10 @@ int reporter_handle_packet( ReportHeader *reporthdr ) {
     } \
   } while (0)
 
-            struct timeval transitTs, deltaTransitTs;
-            __timersub(&packet->packetTime, &packet->sentTime, &transitTs);
+            struct timeval recvTs, transitTs, deltaTransitTs;
+            recvTs.tv_sec = packet->packetTime.tv_sec;
+            recvTs.tv_usec = packet->packetTime.tv_nsec / 1000;
+            __timersub(&recvTs, &packet->sentTime, &transitTs);
             if ( data->lastTransitTs.tv_sec!=0 ||  data->lastTransitTs.tv_usec!=0 ) {
                 sfixpt fTemp;
                 __timersub(&transitTs, &data->lastTransitTs, &deltaTransitTs);
@@ -748,7 +894,11 @@ int reporter_handle_packet( ReportHeader *reporthdr ) {
             
             // from RFC 1889, Real Time Protocol (RTP) 
             // J = J + ( | D(i-1,i) | - J ) / 16 
-            transit = TimeDifference( packet->packetTime, packet->sentTime );
+            // transit mixes the receiver's monotonic clock with the
+            // sender's wall clock, only its changes are meaningful
+            transit = (packet->packetTime.tv_sec - packet->sentTime.tv_sec) +
+                      packet->packetTime.tv_nsec / ((double) rBillion) -
+                      packet->sentTime.tv_usec / ((double) rMillion);
             if ( data->lastTransit != 0.0 ) {
                 deltaTransit = transit - data->lastTransit;
                 if ( deltaTransit < 0.0 ) {
@@ -771,12 +921,106 @@ int reporter_handle_packet( ReportHeader *reporthdr ) {
                 data->PacketID = packet->packetID;
             }
         }
+        if ( packet->frameID > 0 && data->mThreadMode != kMode_Client ) {
+            reporter_handle_frame( data, packet );
+        }
     }
 
     // Print a report if appropriate
     return reporter_condprintstats( &reporthdr->report, reporthdr->multireport, finished );
 }
 
+/*
+ * Track --isochronous frames on the server. A frame is complete when
+ * all of its datagrams have arrived, and its latency is from the
+ * sender's frame start to the arrival of the datagram that completed
+ * it. A frame that is still short when a later frame starts arriving,
+ * or that never showed up at all, counts as lossy. Stragglers from
+ * frames already accounted for are ignored.
+ */
+void reporter_handle_frame( ReporterData *data, ReportStruct *packet ) {
+    double latency;
+
+    if ( packet->frameID < data->frameID ) {
+        return;
+    }
+    if ( packet->frameID > data->frameID ) {
+        if ( data->frameID > 0 ) {
+            if ( data->frameCount < data->frameBurst ) {
+                data->cntFramesLost++;
+            }
+            data->cntFramesLost += packet->frameID - data->frameID - 1;
+        }
+        data->frameID = packet->frameID;
+        data->frameBurst = packet->frameBurst;
+        data->frameCount = 0;
+        if ( data->cntFrames + data->cntFramesLost == 0 && packet->frameBurst > 0 ) {
+            // the listener consumed the test's first datagram, so do
+            // not hold the datagrams of the first frame before this
+            // one against it
+            data->frameCount = packet->packetID % packet->frameBurst;
+        }
+    }
+    data->frameCount++;
+    if ( data->frameCount == data->frameBurst ) {
+        latency = (packet->recvTime.tv_sec - packet->frameTime.tv_sec) +
+                  (packet->recvTime.tv_usec - packet->frameTime.tv_usec) / 
+                  ((double) rMillion);
+        data->cntFrames++;
+        data->frameLatency += latency;
+        if ( latency > data->frameLatencyMax ) {
+            data->frameLatencyMax = latency;
+        }
+        if ( latency > data->intervalLatencyMax ) {
+            data->intervalLatencyMax = latency;
+        }
+    }
+}
+
+/*
+ * Count a --tx-timestamps send delay into the histograms, bin b > 0
+ * holding delays under 2^(b/4) usecs and at least the bin below's
+ */
+void reporter_handle_txdelay( ReporterData *data, double delay ) {
+    int bin = 0;
+    double usecs = delay * rMillion;
+
+    if ( usecs >= 1.0 ) {
+        bin = 1 + (int) (4.0 * log( usecs ) / log( 2.0 ));
+        if ( bin >= NUM_DELAY_BINS ) {
+            bin = NUM_DELAY_BINS - 1;
+        }
+    }
+    data->txDelayBins[bin]++;
+    data->intervalTxDelayBins[bin]++;
+    data->cntTxStamped++;
+    data->txDelay += delay;
+    if ( delay > data->txDelayMax ) {
+        data->txDelayMax = delay;
+    }
+    if ( delay > data->intervalTxDelayMax ) {
+        data->intervalTxDelayMax = delay;
+    }
+}
+
+/*
+ * The delay below which fraction of the count delays in bins fell,
+ * as the top of its bin but no more than the largest delay, max
+ */
+double reporter_delay_percentile( int *bins, int count, double fraction, double max ) {
+    int bin, seen = 0;
+    double top;
+
+    for ( bin = 0; bin < NUM_DELAY_BINS - 1; bin++ ) {
+        seen += bins[bin];
+        if ( seen >= fraction * count ) {
+            break;
+        }
+    }
+    top = pow( 2.0, bin / 4.0 ) / rMillion;
+    return (top < max ? top : max);
+}
+
 /*
  * Handles summing of threads
  */
@@ -859,6 +1103,25 @@ int reporter_condprintstats( ReporterData *stats, MultiHeader *multireport, int
         }
         stats->info.cntDatagrams = (isUDP(stats) ? stats->PacketID : stats->cntDatagrams);
         stats->info.TotalLen = stats->TotalLen;
+        stats->info.cntFrames = stats->cntFrames;
+        stats->info.cntFramesLost = stats->cntFramesLost;
+        stats->info.frameLatency = (stats->cntFrames > 0 ? 
+                                    stats->frameLatency / stats->cntFrames : 0);
+        stats->info.frameLatencyMax = stats->frameLatencyMax;
+        stats->info.cntVerified = stats->cntVerified;
+        stats->info.cntCorrupt = stats->cntCorrupt;
+        stats->info.cntStamped = stats->cntStamped;
+        stats->info.appDelay = (stats->cntStamped > 0 ? 
+                                stats->appDelay / stats->cntStamped : 0);
+        stats->info.appDelayMax = stats->appDelayMax;
+        stats->info.cntTxStamped = stats->cntTxStamped;
+        stats->info.txDelay = (stats->cntTxStamped > 0 ? 
+                               stats->txDelay / stats->cntTxStamped : 0);
+        stats->info.txDelayP50 = reporter_delay_percentile( stats->txDelayBins, 
+                                     stats->cntTxStamped, 0.50, stats->txDelayMax );
+        stats->info.txDelayP99 = reporter_delay_percentile( stats->txDelayBins, 
+                                     stats->cntTxStamped, 0.99, stats->txDelayMax );
+        stats->info.txDelayMax = stats->txDelayMax;
         stats->info.startTime = 0;
         stats->info.endTime = TimeDifference( stats->packetTime, stats->startTime );
         stats->info.free = 1;
@@ -867,7 +1130,7 @@ int reporter_condprintstats( ReporterData *stats, MultiHeader *multireport, int
             reporter_handle_multiple_reports( multireport, &stats->info, force );
         }
     } else while ((stats->intervalTime.tv_sec != 0 || 
-                   stats->intervalTime.tv_usec != 0) && 
+                   stats->intervalTime.tv_nsec != 0) && 
                   TimeDifference( stats->nextTime, 
                                   stats->packetTime ) < 0 ) {
         stats->info.cntOutofOrder = stats->cntOutofOrder - stats->lastOutofOrder;
@@ -884,6 +1147,43 @@ int reporter_condprintstats( ReporterData *stats, MultiHeader *multireport, int
         stats->lastDatagrams = (isUDP( stats ) ? stats->PacketID : stats->cntDatagrams);
         stats->info.TotalLen = stats->TotalLen - stats->lastTotal;
         stats->lastTotal = stats->TotalLen;
+        stats->info.cntFrames = stats->cntFrames - stats->lastFrames;
+        stats->lastFrames = stats->cntFrames;
+        stats->info.cntFramesLost = stats->cntFramesLost - stats->lastFramesLost;
+        stats->lastFramesLost = stats->cntFramesLost;
+        stats->info.frameLatency = (stats->info.cntFrames > 0 ? 
+                                    (stats->frameLatency - stats->lastFrameLatency) / 
+                                    stats->info.cntFrames : 0);
+        stats->lastFrameLatency = stats->frameLatency;
+        stats->info.frameLatencyMax = stats->intervalLatencyMax;
+        stats->intervalLatencyMax = 0;
+        stats->info.cntVerified = stats->cntVerified - stats->lastVerified;
+        stats->lastVerified = stats->cntVerified;
+        stats->info.cntCorrupt = stats->cntCorrupt - stats->lastCorrupt;
+        stats->lastCorrupt = stats->cntCorrupt;
+        stats->info.cntStamped = stats->cntStamped - stats->lastStamped;
+        stats->lastStamped = stats->cntStamped;
+        stats->info.appDelay = (stats->info.cntStamped > 0 ? 
+                                (stats->appDelay - stats->lastAppDelay) / 
+                                stats->info.cntStamped : 0);
+        stats->lastAppDelay = stats->appDelay;
+        stats->info.appDelayMax = stats->intervalAppDelayMax;
+        stats->intervalAppDelayMax = 0;
+        stats->info.cntTxStamped = stats->cntTxStamped - stats->lastTxStamped;
+        stats->lastTxStamped = stats->cntTxStamped;
+        stats->info.txDelay = (stats->info.cntTxStamped > 0 ? 
+                               (stats->txDelay - stats->lastTxDelay) / 
+                               stats->info.cntTxStamped : 0);
+        stats->lastTxDelay = stats->txDelay;
+        stats->info.txDelayP50 = reporter_delay_percentile( stats->intervalTxDelayBins, 
+                                     stats->info.cntTxStamped, 0.50, 
+                                     stats->intervalTxDelayMax );
+        stats->info.txDelayP99 = reporter_delay_percentile( stats->intervalTxDelayBins, 
+                                     stats->info.cntTxStamped, 0.99, 
+                                     stats->intervalTxDelayMax );
+        stats->info.txDelayMax = stats->intervalTxDelayMax;
+        stats->intervalTxDelayMax = 0;
+        memset( stats->intervalTxDelayBins, 0, sizeof(stats->intervalTxDelayBins) );
         stats->info.startTime = stats->info.endTime;
         stats->info.endTime = TimeDifference( stats->nextTime, stats->startTime );
         TimeAdd( stats->nextTime, stats->intervalTime );
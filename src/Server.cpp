@@ -61,6 +61,11 @@
 #include "Extractor.h"
 #include "Reporter.h"
 #include "Locale.h"
+#include "IOUring.h"
+#include "Affinity.h"
+#include "BufferPool.h"
+#include "Verify.h"
+#include "KernelStamp.h"
 
 /* -------------------------------------------------------------------
  * Stores connected socket and socket info.
@@ -69,10 +74,32 @@
 Server::Server( thread_Settings *inSettings ) {
     mSettings = inSettings;
     mBuf = NULL;
+    mStreamReport = NULL;
+    mStreamTotal = 0;
+    mVerify = NULL;
+    if ( mSettings->mVerify ) {
+        mVerify = new Verify_Stream;
+        memset( mVerify, 0, sizeof(Verify_Stream) );
+    }
 
     // initialize buffer
-    mBuf = new char[ mSettings->mBufLen ];
-    FAIL_errno( mBuf == NULL, "No memory for buffer\n", mSettings );
+    if ( !isUDP( mSettings ) && mVerify == NULL ) {
+        // TCP data is counted, never looked at, so every connection
+        // reads into the discard buffer of its CPU
+        int cpu = mSettings->mCPU;
+#ifdef HAVE_SCHED_GETCPU
+        if ( cpu < 0 ) {
+            cpu = sched_getcpu();
+        }
+#endif
+        mBuf = BufferPool_GetShared( mSettings->mBufLen, cpu );
+    } else {
+        mBuf = BufferPool_Get( mSettings->mBufLen );
+        if ( mSettings->mCPU >= 0 ) {
+            // keep it on the NUMA node of the --affinity CPU
+            Affinity_Place( mBuf, mSettings->mBufLen, Affinity_Node( mSettings->mCPU ) );
+        }
+    }
 }
 
 /* -------------------------------------------------------------------
@@ -85,7 +112,8 @@ Server::~Server() {
         WARN_errno( rc == SOCKET_ERROR, "close" );
         mSettings->mSock = INVALID_SOCKET;
     }
-    DELETE_ARRAY( mBuf );
+    BufferPool_Put( mBuf );
+    DELETE_PTR( mVerify );
 }
 
 void Server::Sig_Int( int inSigno ) {
@@ -97,45 +125,42 @@ void Server::Sig_Int( int inSigno ) {
  * Does not close the socket. 
  * ------------------------------------------------------------------- */ 
 void Server::Run( void ) {
-    long currLen; 
     max_size_t totLen = 0;
-    struct UDP_datagram* mBuf_UDP  = (struct UDP_datagram*) mBuf; 
 
     ReportStruct *reportstruct = NULL;
 
     reportstruct = new ReportStruct;
     if ( reportstruct != NULL ) {
         reportstruct->packetID = 0;
+        reportstruct->frameID = 0;
+        reportstruct->verified = 0;
+        reportstruct->corrupt = 0;
+        reportstruct->appDelay = -1;
         mSettings->reporthdr = InitReport( mSettings );
-        do {
-            // perform read 
-            currLen = recv( mSettings->mSock, mBuf, mSettings->mBufLen, 0 ); 
-        
-            if ( isUDP( mSettings ) ) {
-                // read the datagram ID and sentTime out of the buffer 
-                reportstruct->packetID = ntohl( mBuf_UDP->id ); 
-                reportstruct->sentTime.tv_sec = ntohl( mBuf_UDP->tv_sec  );
-                reportstruct->sentTime.tv_usec = ntohl( mBuf_UDP->tv_usec ); 
-		reportstruct->packetLen = currLen;
-		gettimeofday( &(reportstruct->packetTime), NULL );
-            } else {
-		totLen += currLen;
-	    }
-        
-            // terminate when datagram begins with negative index 
-            // the datagram ID should be correct, just negated 
-            if ( reportstruct->packetID < 0 ) {
-                reportstruct->packetID = -reportstruct->packetID;
-                currLen = -1; 
-            }
-	    if ( isUDP (mSettings))
-		ReportPacket( mSettings->reporthdr, reportstruct );
-        } while ( currLen > 0 ); 
+        // io_uring reads carry no kernel stamps, --rx-timestamps takes recvmmsg()
+        bool done = ( isIOUring( mSettings ) && 
+                      !(isUDP( mSettings ) && mSettings->mRxStamps) &&
+                      RunURing( reportstruct, &totLen ) );
+        if ( !done && isUDP( mSettings ) && 
+             (mSettings->mBatchSize > 1 || mSettings->mUDPGRO || mSettings->mRxStamps) ) {
+            done = RunBatch( reportstruct, &totLen );
+        }
+        if ( !done ) {
+            long currLen; 
+            do {
+                // perform read 
+                currLen = recv( mSettings->mSock, mBuf, mSettings->mBufLen, 0 ); 
+            } while ( ReadPacket( mBuf, currLen, reportstruct, &totLen ) ); 
+        }
         
         // stop timing 
-        gettimeofday( &(reportstruct->packetTime), NULL );
+        gettime_monotonic( &(reportstruct->packetTime) );
 	if ( !isUDP (mSettings)) {
 		reportstruct->packetLen = totLen;
+		if ( mVerify != NULL ) {
+		    reportstruct->verified = mVerify->verified;
+		    reportstruct->corrupt = mVerify->corrupt;
+		}
 		ReportPacket( mSettings->reporthdr, reportstruct );
 	}
         CloseReport( mSettings->reporthdr, reportstruct );
@@ -158,6 +183,413 @@ void Server::Run( void ) {
 } 
 // end Recv 
 
+/* ------------------------------------------------------------------- 
+ * Account for one read of currLen bytes into buf, as Run's loop
+ * always has. Returns false once the transfer is over, at the end
+ * of the stream, on an error or at the client's terminating datagram.
+ * ------------------------------------------------------------------- */ 
+
+bool Server::ReadPacket( char *buf, long currLen, ReportStruct *reportstruct, 
+                         max_size_t *totLen ) {
+    bool more;
+
+    if ( isUDP( mSettings ) ) {
+        gettime_monotonic( &(reportstruct->packetTime) );
+    }
+    more = ParsePacket( buf, currLen, reportstruct, totLen );
+    if ( isUDP (mSettings))
+        ReportPacket( mSettings->reporthdr, reportstruct );
+    return more;
+}
+
+/* ------------------------------------------------------------------- 
+ * ReadPacket without the reporting, for the callers that report
+ * many datagrams at once. A datagram's packetTime is left to them.
+ * ------------------------------------------------------------------- */ 
+
+bool Server::ParsePacket( char *buf, long currLen, ReportStruct *reportstruct, 
+                          max_size_t *totLen ) {
+    struct UDP_datagram* mBuf_UDP  = (struct UDP_datagram*) buf; 
+
+    if ( isUDP( mSettings ) ) {
+        // read the datagram ID and sentTime out of the buffer 
+        reportstruct->packetID = ntohl( mBuf_UDP->id ); 
+        reportstruct->sentTime.tv_sec = ntohl( mBuf_UDP->tv_sec  );
+        reportstruct->sentTime.tv_usec = ntohl( mBuf_UDP->tv_usec ); 
+        reportstruct->packetLen = currLen;
+
+        // --isochronous datagrams carry their frame after the client_hdr
+        reportstruct->frameID = 0;
+        if ( currLen >= (int) (sizeof(UDP_datagram) + sizeof(client_hdr) 
+                               + sizeof(isoch_hdr)) ) {
+            client_hdr *hdr = (client_hdr*) (mBuf_UDP + 1);
+            if ( (ntohl( hdr->flags ) & HEADER_ISOCH) != 0 ) {
+                isoch_hdr *isoch = (isoch_hdr*) (hdr + 1);
+                reportstruct->frameID = ntohl( isoch->frameid );
+                reportstruct->frameBurst = ntohl( isoch->burstsize );
+                reportstruct->frameTime.tv_sec = ntohl( isoch->start_tv_sec );
+                reportstruct->frameTime.tv_usec = ntohl( isoch->start_tv_usec );
+                gettimeofday( &(reportstruct->recvTime), NULL );
+            }
+        }
+
+        // --rx-timestamps, left to the callers that have the stamp
+        reportstruct->appDelay = -1;
+
+        // --verify, the terminating datagram is not checksummed
+        reportstruct->verified = 0;
+        reportstruct->corrupt = 0;
+        if ( mVerify != NULL && reportstruct->packetID >= 0 &&
+             currLen >= (long) (sizeof(UDP_datagram) + sizeof(u_int32_t)) ) {
+            if ( Verify_CheckDatagram( buf, currLen ) ) {
+                reportstruct->verified = 1;
+            } else {
+                reportstruct->corrupt = 1;
+            }
+        }
+    } else if ( currLen > 0 ) {
+        *totLen += currLen;
+        if ( mVerify != NULL ) {
+            Verify_CheckStream( mVerify, buf, currLen );
+        }
+    }
+
+    // terminate when datagram begins with negative index 
+    // the datagram ID should be correct, just negated 
+    if ( reportstruct->packetID < 0 ) {
+        reportstruct->packetID = -reportstruct->packetID;
+        currLen = -1; 
+    }
+    return currLen > 0;
+}
+
+/* ------------------------------------------------------------------- 
+ * Receive UDP with --udp-batch and --udp-gro. Each recvmmsg() returns
+ * up to mBatchSize reads, waiting only for the first. With UDP_GRO a
+ * read may hold many datagrams the kernel coalesced, all of the
+ * segment size its control message gives but the last, which are
+ * split apart again so the reporter sees every datagram. Datagrams
+ * from one recvmmsg() share the time it returned, or with
+ * --rx-timestamps the time the kernel stamped their read, and are
+ * handed to the reporter together. Returns false, having read
+ * nothing, if the kernel lacks recvmmsg() so Run falls back to recv().
+ * ------------------------------------------------------------------- */ 
+
+const int kGRO_MaxBytes    = 65535;     // largest coalesced read
+const int kGRO_MaxSegments = 64;        // UDP_GRO_CNT_MAX in the Linux kernel
+
+bool Server::RunBatch( ReportStruct *reportstruct, max_size_t *totLen ) {
+#ifdef HAVE_RECVMMSG
+    int batch = mSettings->mBatchSize;
+    int len = mSettings->mBufLen;
+    int ctlLen = 0;
+    int room;
+    char *bufs;
+    char *ctls = NULL;
+    struct mmsghdr *msgs;
+    struct iovec *iov;
+    ReportStruct *packets;
+    struct timespec arrived;
+    struct timespec offset;
+    bool gro = false;
+    bool more = true;
+    bool any = false;
+    int i;
+
+    if ( mSettings->mUDPGRO ) {
+#ifdef UDP_GRO
+        int on = 1;
+        if ( setsockopt( mSettings->mSock, IPPROTO_UDP, UDP_GRO, 
+                         (char*) &on, sizeof(on) ) == 0 ) {
+            len = kGRO_MaxBytes;
+            ctlLen = CMSG_SPACE( sizeof(int) );
+            gro = true;
+        } else {
+            fprintf( stderr, warn_gro_unsupported, strerror( errno ) );
+            mSettings->mUDPGRO = 0;
+        }
+#else
+        fprintf( stderr, warn_gro_unsupported, "UDP_GRO undefined" );
+        mSettings->mUDPGRO = 0;
+#endif
+    }
+    if ( mSettings->mRxStamps ) {
+        if ( KernelStamp_EnableRX( mSettings->mSock ) == 0 ) {
+            ctlLen += KernelStamp_ControlLen();
+        } else {
+            fprintf( stderr, warn_rxstamps_unsupported, strerror( errno ) );
+            mSettings->mRxStamps = 0;
+        }
+    }
+    room = batch * (gro ? kGRO_MaxSegments : 1);
+    bufs = BufferPool_Get( (size_t) batch * len );
+    msgs = new struct mmsghdr[ batch ];
+    iov = new struct iovec[ batch ];
+    packets = new ReportStruct[ room ];
+    if ( ctlLen > 0 ) {
+        ctls = new char[ batch * ctlLen ];
+    }
+
+    memset( msgs, 0, batch * sizeof(struct mmsghdr) );
+    for ( i = 0; i < batch; i++ ) {
+        iov[i].iov_base = bufs + i * len;
+        iov[i].iov_len = len;
+        msgs[i].msg_hdr.msg_iov = &iov[i];
+        msgs[i].msg_hdr.msg_iovlen = 1;
+    }
+    for ( i = 0; i < room; i++ ) {
+        packets[i] = *reportstruct;
+    }
+    while ( more ) {
+        int count, n = 0;
+        if ( ctlLen > 0 ) {
+            for ( i = 0; i < batch; i++ ) {
+                msgs[i].msg_hdr.msg_control = ctls + i * ctlLen;
+                msgs[i].msg_hdr.msg_controllen = ctlLen;
+            }
+        }
+        // block for the first datagram, then take what else is queued
+        count = recvmmsg( mSettings->mSock, msgs, batch, MSG_WAITFORONE, NULL );
+        if ( count < 0 ) {
+            if ( errno == ENOSYS && !any ) {
+                break;
+            }
+            // an error ends the transfer as a failed recv() does, with
+            // no datagram in mBuf to hand the reporter, Run closes it
+            break;
+        }
+        any = true;
+        gettime_monotonic( &arrived );
+        if ( mSettings->mRxStamps ) {
+            KernelStamp_ClockOffset( &offset );
+        }
+        for ( i = 0; i < count && more; i++ ) {
+            char *buf = bufs + i * len;
+            long left = msgs[i].msg_len;
+            long segment = left;
+            struct timespec stamp = arrived;
+            double appDelay = -1;
+            if ( mSettings->mRxStamps && 
+                 KernelStamp_RX( &msgs[i].msg_hdr, &offset, &stamp ) ) {
+                // how long the datagram waited for this thread
+                appDelay = TimeDifference( arrived, stamp );
+                if ( appDelay < 0 ) {
+                    appDelay = 0;
+                }
+            }
+#ifdef UDP_GRO
+            struct cmsghdr *cmsg;
+            for ( cmsg = CMSG_FIRSTHDR( &msgs[i].msg_hdr ); gro && cmsg != NULL; 
+                  cmsg = CMSG_NXTHDR( &msgs[i].msg_hdr, cmsg ) ) {
+                if ( cmsg->cmsg_level == IPPROTO_UDP && cmsg->cmsg_type == UDP_GRO ) {
+                    int gso;
+                    memcpy( &gso, CMSG_DATA( cmsg ), sizeof(gso) );
+                    if ( gso > 0 ) {
+                        segment = gso;
+                    }
+                }
+            }
+#endif
+            // one record per datagram, even when the kernel coalesced them
+            do {
+                long dgram = ( left < segment ? left : segment );
+                packets[n].packetTime = stamp;
+                more = ParsePacket( buf, dgram, &packets[n], totLen );
+                packets[n].appDelay = appDelay;
+                n++;
+                if ( !more ) {
+                    // the terminating datagram, kept for the AckFIN
+                    memcpy( mBuf, buf, (dgram < mSettings->mBufLen ? dgram : mSettings->mBufLen) );
+                    *reportstruct = packets[n - 1];
+                }
+                buf += dgram;
+                left -= dgram;
+            } while ( left > 0 && more && n < room );
+        }
+        ReportPacketBatch( mSettings->reporthdr, packets, n );
+    }
+    DELETE_ARRAY( ctls );
+    DELETE_ARRAY( packets );
+    DELETE_ARRAY( iov );
+    DELETE_ARRAY( msgs );
+    BufferPool_Put( bufs );
+    return any;
+#else
+    return false;
+#endif
+}
+
+/* ------------------------------------------------------------------- 
+ * Receive with --io-uring. One multishot receive stays armed on the
+ * socket and each completion names a buffer the kernel took from the
+ * ring of kIOUring_Buffers provided buffers, which is handed straight
+ * back once ReadPacket has looked at it. Returns false, having read
+ * nothing, if the kernel cannot do this so Run falls back to recv().
+ * ------------------------------------------------------------------- */ 
+
+const int kIOUring_Entries = 8;
+const int kIOUring_Buffers = 64;        // a power of 2
+
+bool Server::RunURing( ReportStruct *reportstruct, max_size_t *totLen ) {
+#ifdef HAVE_IO_URING
+    IOUring ring;
+    struct io_uring_sqe *sqe;
+    struct io_uring_cqe *cqe;
+    bool armed = false;
+    bool done = false;
+    bool any = false;
+    int rc;
+
+    if ( !IOUring_Initialize( &ring, kIOUring_Entries ) ) {
+        fprintf( stderr, warn_iouring_unsupported, strerror( errno ) );
+        unsetIOUring( mSettings );
+        return false;
+    }
+    if ( !IOUring_SetupBufRing( &ring, kIOUring_Buffers, mSettings->mBufLen ) ) {
+        fprintf( stderr, warn_iouring_unsupported, strerror( errno ) );
+        unsetIOUring( mSettings );
+        IOUring_Destroy( &ring );
+        return false;
+    }
+
+    while ( armed || !done ) {
+        if ( !armed && !done ) {
+            // (re)arm the receive, it stays armed until it runs out
+            // of buffers or the socket ends
+            sqe = IOUring_getSQE( &ring );
+            sqe->opcode = IORING_OP_RECV;
+            sqe->fd = mSettings->mSock;
+            sqe->flags = IOSQE_BUFFER_SELECT;
+            sqe->ioprio = IORING_RECV_MULTISHOT;
+            sqe->buf_group = 0;
+            sqe->user_data = 1;
+            armed = true;
+        }
+        rc = IOUring_Submit( &ring, 1 );
+        if ( rc < 0 && rc != -EINTR && rc != -EAGAIN && rc != -EBUSY ) {
+            errno = -rc;
+            WARN_errno( 1, "io_uring_enter" );
+            break;
+        }
+        while ( (cqe = IOUring_peekCQE( &ring )) != NULL ) {
+            int res = cqe->res;
+            unsigned flags = cqe->flags;
+            IOUring_seenCQE( &ring );
+
+            if ( cqe->user_data != 1 ) {
+                // the cancel request
+                continue;
+            }
+            if ( !(flags & IORING_CQE_F_MORE) ) {
+                armed = false;
+            }
+            if ( res == -ENOBUFS || res == -ECANCELED ) {
+                // out of buffers, re-armed above once they are back
+                continue;
+            }
+            if ( res < 0 && !any ) {
+                // no multishot receive in this kernel
+                fprintf( stderr, warn_iouring_unsupported, strerror( -res ) );
+                unsetIOUring( mSettings );
+                IOUring_Destroy( &ring );
+                return false;
+            }
+            if ( done ) {
+                if ( flags & IORING_CQE_F_BUFFER ) {
+                    IOUring_putBuffer( &ring, flags >> IORING_CQE_BUFFER_SHIFT );
+                }
+                continue;
+            }
+            any = true;
+            if ( res > 0 && (flags & IORING_CQE_F_BUFFER) ) {
+                unsigned short bid = flags >> IORING_CQE_BUFFER_SHIFT;
+                char *buf = IOUring_getBuffer( &ring, bid );
+                if ( !ReadPacket( buf, res, reportstruct, totLen ) ) {
+                    // the terminating datagram, kept for the AckFIN
+                    memcpy( mBuf, buf, res );
+                    done = true;
+                }
+                IOUring_putBuffer( &ring, bid );
+            } else {
+                // end of the stream or an error, nothing was read into
+                // a buffer so there is no datagram to report
+                if ( res < 0 ) {
+                    errno = -res;
+                }
+                done = true;
+            }
+            if ( done && armed ) {
+                // stop the receive before the AckFIN reads the socket
+                sqe = IOUring_getSQE( &ring );
+                sqe->opcode = IORING_OP_ASYNC_CANCEL;
+                sqe->addr = 1;
+                sqe->user_data = 2;
+            }
+        }
+    }
+    IOUring_Destroy( &ring );
+    return true;
+#else
+    fprintf( stderr, warn_iouring_unsupported, strerror( ENOSYS ) );
+    unsetIOUring( mSettings );
+    return false;
+#endif
+}
+
+/* ------------------------------------------------------------------- 
+ * Connection interface for ServerEngine. Instead of blocking in Run,
+ * the connection is read whenever it is readable and reports the
+ * same way Run does for TCP, so the per connection and sum reports
+ * are unchanged.
+ * ------------------------------------------------------------------- */ 
+
+void Server::StreamStart( void ) {
+    mStreamReport = new ReportStruct;
+    mStreamReport->packetID = 0;
+    mStreamReport->frameID = 0;
+    mStreamReport->verified = 0;
+    mStreamReport->corrupt = 0;
+    mStreamReport->appDelay = -1;
+    mStreamTotal = 0;
+    mSettings->reporthdr = InitReport( mSettings );
+
+#ifdef HAVE_SYS_EPOLL_H
+    // the worker waits on all of its connections, none of them may block
+    int flags = fcntl( mSettings->mSock, F_GETFL, 0 );
+    fcntl( mSettings->mSock, F_SETFL, flags | O_NONBLOCK );
+#endif
+}
+
+long Server::StreamRead( void ) {
+    long currLen = recv( mSettings->mSock, mBuf, mSettings->mBufLen, 0 ); 
+    if ( currLen > 0 ) {
+        mStreamTotal += currLen;
+        if ( mVerify != NULL ) {
+            Verify_CheckStream( mVerify, mBuf, currLen );
+        }
+    }
+    return currLen;
+}
+
+void Server::StreamEnd( void ) {
+    // stop timing 
+    gettime_monotonic( &(mStreamReport->packetTime) );
+    mStreamReport->packetLen = mStreamTotal;
+    if ( mVerify != NULL ) {
+        mStreamReport->verified = mVerify->verified;
+        mStreamReport->corrupt = mVerify->corrupt;
+    }
+    ReportPacket( mSettings->reporthdr, mStreamReport );
+    CloseReport( mSettings->reporthdr, mStreamReport );
+
+    Mutex_Lock( &clients_mutex );     
+    Iperf_delete( &(mSettings->peer), &clients ); 
+    Mutex_Unlock( &clients_mutex );
+
+    DELETE_PTR( mStreamReport );
+    EndReport( mSettings->reporthdr );
+}
+
 /* ------------------------------------------------------------------- 
  * Send an AckFIN (a datagram acknowledging a FIN) on the socket, 
  * then select on the socket for some time. If additional datagrams 
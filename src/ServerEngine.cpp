@@ -0,0 +1,213 @@
+/*--------------------------------------------------------------- 
+ * Copyright (c) 1999,2000,2001,2002,2003                       
+ * The Board of Trustees of the University of Illinois            
+ * All Rights Reserved.                                           
+ *--------------------------------------------------------------- 
+ * Permission is hereby granted, free of charge, to any person    
+ * obtaining a copy of this software (Iperf) and associated       
+ * documentation files (the "Software"), to deal in the Software  
+ * without restriction, including without limitation the          
+ * rights to use, copy, modify, merge, publish, distribute,        
+ * sublicense, and/or sell copies of the Software, and to permit     
+ * persons to whom the Software is furnished to do
+ * so, subject to the following conditions: 
+ *
+ *     
+ * Redistributions of source code must retain the above 
+ * copyright notice, this list of conditions and 
+ * the following disclaimers. 
+ *
+ *     
+ * Redistributions in binary form must reproduce the above 
+ * copyright notice, this list of conditions and the following 
+ * disclaimers in the documentation and/or other materials 
+ * provided with the distribution. 
+ * 
+ *     
+ * Neither the names of the University of Illinois, NCSA, 
+ * nor the names of its contributors may be used to endorse 
+ * or promote products derived from this Software without
+ * specific prior written permission. 
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, 
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES 
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND 
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE CONTIBUTORS OR COPYRIGHT 
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, 
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, 
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE. 
+ * ________________________________________________________________
+ * National Laboratory for Applied Network Research 
+ * National Center for Supercomputing Applications 
+ * University of Illinois at Urbana-Champaign 
+ * http://www.ncsa.uiuc.edu
+ * ________________________________________________________________ 
+ *
+ * ServerEngine.cpp
+ * -------------------------------------------------------------------
+ * Serves a --workers thread's TCP connections from one epoll loop.
+ * Each connection is a Server driven through its Stream* calls, so
+ * it reports and ends the test exactly as a connection with its own
+ * thread.
+ * ------------------------------------------------------------------- */
+
+#include "headers.h"
+#include "ServerEngine.hpp"
+#include "Thread.h"
+#include "PerfSocket.hpp"
+#include "util.h"
+
+#ifdef HAVE_SYS_EPOLL_H
+
+ServerEngine::ServerEngine( thread_Settings *inSettings ) {
+    struct epoll_event event;
+
+    mSettings = inSettings;
+    mQueue = NULL;
+    mShutdown = false;
+    mActive = 0;
+    Mutex_Initialize( &mLock );
+
+    mEpoll = epoll_create( kMax_Events );
+    FAIL_errno( mEpoll < 0, "epoll_create", mSettings );
+
+    int rc = pipe( mWakeup );
+    FAIL_errno( rc < 0, "pipe", mSettings );
+    fcntl( mWakeup[0], F_SETFL, fcntl( mWakeup[0], F_GETFL, 0 ) | O_NONBLOCK );
+
+    // the wakeup pipe is the one event without a Connection
+    memset( &event, 0, sizeof(event) );
+    event.events = EPOLLIN;
+    event.data.ptr = NULL;
+    rc = epoll_ctl( mEpoll, EPOLL_CTL_ADD, mWakeup[0], &event );
+    WARN_errno( rc < 0, "epoll_ctl" );
+} // end ServerEngine
+
+ServerEngine::~ServerEngine() {
+    close( mEpoll );
+    close( mWakeup[0] );
+    close( mWakeup[1] );
+    Mutex_Destroy( &mLock );
+} // end ~ServerEngine
+
+/* -------------------------------------------------------------------
+ * Wait for connections from the Listener and data on them. After a
+ * Ctrl-C the worker stops once its connections end, as the server
+ * threads do.
+ * ------------------------------------------------------------------- */
+
+void ServerEngine::Run( void ) {
+    struct epoll_event events[ kMax_Events ];
+
+    for ( ;; ) {
+        int ready = epoll_wait( mEpoll, events, kMax_Events, kWait_Msecs );
+        if ( ready < 0 && errno != EINTR ) {
+            WARN_errno( ready < 0, "epoll_wait" );
+            break;
+        }
+        for ( int k = 0; k < ready; k++ ) {
+            if ( events[k].data.ptr == NULL ) {
+                Drain();
+            } else {
+                Service( (Connection*) events[k].data.ptr );
+            }
+        }
+
+        if ( mActive == 0 ) {
+            Mutex_Lock( &mLock );
+            bool done = ( mQueue == NULL && (mShutdown || sInterupted) );
+            Mutex_Unlock( &mLock );
+            if ( done ) {
+                break;
+            }
+        }
+    }
+} // end Run
+
+void ServerEngine::Add( thread_Settings *server ) {
+    Connection *conn = new Connection;
+    char wake = 0;
+
+    conn->settings = server;
+    conn->server = NULL;
+    Mutex_Lock( &mLock );
+    conn->next = mQueue;
+    mQueue = conn;
+    write( mWakeup[1], &wake, 1 );
+    Mutex_Unlock( &mLock );
+}
+
+void ServerEngine::Shutdown( void ) {
+    char wake = 0;
+
+    // Run checks mShutdown under the lock, so the worker cannot
+    // finish and free this engine before the write
+    Mutex_Lock( &mLock );
+    mShutdown = true;
+    write( mWakeup[1], &wake, 1 );
+    Mutex_Unlock( &mLock );
+}
+
+void ServerEngine::Drain( void ) {
+    char wake[64];
+    Connection *conn;
+
+    while ( read( mWakeup[0], wake, sizeof(wake) ) > 0 ) {
+    }
+    Mutex_Lock( &mLock );
+    conn = mQueue;
+    mQueue = NULL;
+    Mutex_Unlock( &mLock );
+
+    while ( conn != NULL ) {
+        Connection *next = conn->next;
+        struct epoll_event event;
+
+        conn->server = new Server( conn->settings );
+        conn->server->StreamStart();
+        memset( &event, 0, sizeof(event) );
+        event.events = EPOLLIN;
+        event.data.ptr = conn;
+        int rc = epoll_ctl( mEpoll, EPOLL_CTL_ADD, conn->settings->mSock, &event );
+        WARN_errno( rc < 0, "epoll_ctl" );
+        mActive++;
+        conn = next;
+    }
+}
+
+void ServerEngine::Service( Connection *conn ) {
+    for ( int budget = kRead_Budget; budget > 0; budget-- ) {
+        long currLen = conn->server->StreamRead();
+        if ( currLen < 0 && (errno == EAGAIN || errno == EWOULDBLOCK) ) {
+            return;
+        }
+        if ( currLen <= 0 ) {
+            // the client closed the connection, or it failed
+            Finish( conn );
+            return;
+        }
+    }
+}
+
+/* -------------------------------------------------------------------
+ * Like the end of a server thread, this starts a -r test back to
+ * the client once the connection ends.
+ * ------------------------------------------------------------------- */
+
+void ServerEngine::Finish( Connection *conn ) {
+    thread_Settings *next = conn->settings->runNext;
+
+    epoll_ctl( mEpoll, EPOLL_CTL_DEL, conn->settings->mSock, NULL );
+    conn->server->StreamEnd();
+    DELETE_PTR( conn->server );
+    Settings_Destroy( conn->settings );
+    DELETE_PTR( conn );
+    mActive--;
+
+    if ( next != NULL ) {
+        thread_start( next );
+    }
+}
+
+#endif // HAVE_SYS_EPOLL_H
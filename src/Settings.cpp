@@ -66,6 +66,8 @@
 #include "Settings.hpp"
 #include "Locale.h"
 #include "SocketAddr.h"
+#include "Affinity.h"
+#include "delay.hpp"
 
 #include "util.h"
 
@@ -73,6 +75,36 @@
 
 void Settings_Interpret( char option, const char *optarg, thread_Settings *mExtSettings );
 
+/* -------------------------------------------------------------------
+ * long options without a short option equivalent
+ *
+ * gnu_getopt_long sets the matching variable and returns 0, which
+ * Settings_Interpret then dispatches on.
+ * ------------------------------------------------------------------- */
+static int udpbatch = 0;
+static int udpgso = 0;
+static int udpgro = 0;
+static int rxstamps = 0;
+static int txstamps = 0;
+static int zerocopy = 0;
+static int fileloop = 0;
+static int filesend = 0;
+static int burstsize = 0;
+static int fqrate = 0;
+static int delayspin = 0;
+static int isochronous = 0;
+static int gapdist = 0;
+static int seed = 0;
+static int trace = 0;
+static int sizemix = 0;
+static int workers = 0;
+static int reuseportcpu = 0;
+static int iouring = 0;
+static int affinity = 0;
+static int reporteraffinity = 0;
+static int hugepages = 0;
+static int verify = 0;
+
 /* -------------------------------------------------------------------
  * command line options
  *
@@ -121,6 +153,29 @@ const struct option long_options[] =
 {"ipv6_domain",      no_argument, NULL, 'V'},
 {"suggest_win_size", no_argument, NULL, 'W'},
 {"linux-congestion", required_argument, NULL, 'Z'},
+{"udp-batch",  required_argument, &udpbatch, 1},
+{"udp-gso",          no_argument, &udpgso, 1},
+{"udp-gro",          no_argument, &udpgro, 1},
+{"rx-timestamps",    no_argument, &rxstamps, 1},
+{"tx-timestamps",    no_argument, &txstamps, 1},
+{"zerocopy",         no_argument, &zerocopy, 1},
+{"file-loop",        no_argument, &fileloop, 1},
+{"sendfile",         no_argument, &filesend, 1},
+{"burst-size", required_argument, &burstsize, 1},
+{"fq-rate",    required_argument, &fqrate, 1},
+{"delay-spin", required_argument, &delayspin, 1},
+{"isochronous", required_argument, &isochronous, 1},
+{"gap-dist",   required_argument, &gapdist, 1},
+{"seed",       required_argument, &seed, 1},
+{"trace",      required_argument, &trace, 1},
+{"size-mix",   required_argument, &sizemix, 1},
+{"workers",    required_argument, &workers, 1},
+{"reuseport-cpu",    no_argument, &reuseportcpu, 1},
+{"io-uring",         no_argument, &iouring, 1},
+{"affinity",   required_argument, &affinity, 1},
+{"reporter-affinity", required_argument, &reporteraffinity, 1},
+{"hugepages",        no_argument, &hugepages, 1},
+{"verify",           no_argument, &verify, 1},
 {0, 0, 0, 0}
 };
 
@@ -164,6 +219,29 @@ const struct option env_options[] =
 {"IPERF_IPV6_DOMAIN",      no_argument, NULL, 'V'},
 {"IPERF_SUGGEST_WIN_SIZE", required_argument, NULL, 'W'},
 {"IPERF_CONGESTION_CONTROL",  required_argument, NULL, 'Z'},
+{"IPERF_UDP_BATCH",  required_argument, &udpbatch, 1},
+{"IPERF_UDP_GSO",          no_argument, &udpgso, 1},
+{"IPERF_UDP_GRO",          no_argument, &udpgro, 1},
+{"IPERF_RX_TIMESTAMPS",    no_argument, &rxstamps, 1},
+{"IPERF_TX_TIMESTAMPS",    no_argument, &txstamps, 1},
+{"IPERF_ZEROCOPY",         no_argument, &zerocopy, 1},
+{"IPERF_FILE_LOOP",        no_argument, &fileloop, 1},
+{"IPERF_SENDFILE",         no_argument, &filesend, 1},
+{"IPERF_BURST_SIZE", required_argument, &burstsize, 1},
+{"IPERF_FQ_RATE",    required_argument, &fqrate, 1},
+{"IPERF_DELAY_SPIN", required_argument, &delayspin, 1},
+{"IPERF_ISOCHRONOUS", required_argument, &isochronous, 1},
+{"IPERF_GAP_DIST",   required_argument, &gapdist, 1},
+{"IPERF_SEED",       required_argument, &seed, 1},
+{"IPERF_TRACE",      required_argument, &trace, 1},
+{"IPERF_SIZE_MIX",   required_argument, &sizemix, 1},
+{"IPERF_WORKERS",    required_argument, &workers, 1},
+{"IPERF_REUSEPORT_CPU",    no_argument, &reuseportcpu, 1},
+{"IPERF_IO_URING",         no_argument, &iouring, 1},
+{"IPERF_AFFINITY",   required_argument, &affinity, 1},
+{"IPERF_REPORTER_AFFINITY", required_argument, &reporteraffinity, 1},
+{"IPERF_HUGEPAGES",        no_argument, &hugepages, 1},
+{"IPERF_VERIFY",           no_argument, &verify, 1},
 {0, 0, 0, 0}
 };
 
@@ -183,6 +261,9 @@ const int  kDefault_UDPBufLen = 1470;      // -u  if set, read/write 1470 bytes
 // 1450 bytes is small enough to be sending one packet per datagram on ethernet
 //  **** with IPv6 ****
 
+const int  kMax_BatchSize = 1024;          // --udp-batch, the sendmmsg() and recvmmsg() vlen limit
+const char kIMIX[] = "64:7,594:4,1518:1"; // --size-mix imix, the simple IMIX
+
 /* -------------------------------------------------------------------
  * Initialize all settings to defaults.
  * ------------------------------------------------------------------- */
@@ -211,7 +292,7 @@ void Settings_Initialize( thread_Settings *main ) {
     // mMode    = kTest_Normal;          // -r,  mMode == kTest_TradeOff
     main->mThreadMode   = kMode_Unknown; // -s,  or -c, none
     main->mAmount       = 1000;          // -t,  10 seconds
-    // mUDPRate > 0 means UDP            // -u,  N/A, see kDefault_UDPRate
+    // mUDPRate > 0 with TCP rate limits // -b,  see kDefault_UDPRate for -u
     // skip version                      // -v,
     //main->mTCPWin       = 0;           // -w,  ie. don't set window
 
@@ -229,6 +310,9 @@ void Settings_Initialize( thread_Settings *main ) {
     //main->mRemoveService = false;      // -R,
     //main->mTOS          = 0;           // -S,  ie. don't set type of service
     main->mTTL          = 1;             // -T,  link-local TTL
+    main->mBatchSize    = 1;             // --udp-batch, one datagram per write
+    main->mDelaySpin    = kDefault_DelaySpin; // --delay-spin, usecs
+    main->mCPU          = -1;            // --affinity, not pinned
     //main->mDomain     = kMode_IPv4;    // -V,
     //main->mSuggestWin = false;         // -W,  Suggest the window size.
 
@@ -253,6 +337,10 @@ void Settings_Copy( thread_Settings *from, thread_Settings **into ) {
         (*into)->mFileName = new char[ strlen(from->mFileName) + 1];
         strcpy( (*into)->mFileName, from->mFileName );
     }
+    if ( from->mTraceName != NULL ) {
+        (*into)->mTraceName = new char[ strlen(from->mTraceName) + 1];
+        strcpy( (*into)->mTraceName, from->mTraceName );
+    }
     // Zero out certain entries
     (*into)->mTID = thread_zeroid();
     (*into)->runNext = NULL;
@@ -267,10 +355,74 @@ void Settings_Destroy( thread_Settings *mSettings) {
     DELETE_ARRAY( mSettings->mHost      );
     DELETE_ARRAY( mSettings->mLocalhost );
     DELETE_ARRAY( mSettings->mFileName  );
+    DELETE_ARRAY( mSettings->mTraceName );
     DELETE_ARRAY( mSettings->mOutputFileName );
     DELETE_PTR( mSettings );
 } // end ~Settings
 
+/* -------------------------------------------------------------------
+ * Parses a --size-mix, "imix" or a list of <size>[:<weight>] such as
+ * 64:7,594:4,1518:1. Sizes may use K and M like -l.
+ * ------------------------------------------------------------------- */
+void Settings_ParseSizeMix( thread_Settings *mSettings, const char *mix ) {
+    char sizearg[100];
+    char outarg[100];
+    const char *item = mix;
+    int count = 0;
+
+    if ( strcmp( mix, "imix" ) == 0 || strcmp( mix, "IMIX" ) == 0 ) {
+        item = kIMIX;
+    }
+    while ( item != NULL && *item != '\0' ) {
+        const char *next = strchr( item, ',' );
+        const char *weight = strchr( item, ':' );
+        int len = ( next != NULL ? next - item : (int) strlen( item ) );
+
+        if ( weight != NULL && next != NULL && weight > next ) {
+            weight = NULL;
+        }
+        if ( len >= (int) sizeof(sizearg) || count == MAX_SIZE_CLASSES ) {
+            count = -1;
+            break;
+        }
+        strncpy( sizearg, item, len );
+        sizearg[ (weight != NULL ? weight - item : len) ] = '\0';
+        Settings_GetUpperCaseArg( sizearg, outarg );
+        mSettings->mSizes[count] = byte_atoi( outarg );
+        mSettings->mSizeWeights[count] = ( weight != NULL ? atoi( weight + 1 ) : 1 );
+        if ( mSettings->mSizes[count] <= 0 || mSettings->mSizeWeights[count] <= 0 ) {
+            count = -1;
+            break;
+        }
+        count++;
+        item = ( next != NULL ? next + 1 : NULL );
+    }
+    if ( count <= 0 ) {
+        fprintf( stderr, warn_invalid_size_mix, mix, MAX_SIZE_CLASSES );
+        count = 0;
+    }
+    mSettings->mSizeCount = count;
+}
+
+/* -------------------------------------------------------------------
+ * Parses an --affinity or --reporter-affinity CPU list, e.g. 0-3,8
+ * or rr. The list is made once here and shared by every copy of the
+ * settings for the rest of the run.
+ * ------------------------------------------------------------------- */
+void Settings_ParseAffinity( const char *list, int **cpus, int *count ) {
+    int parsed[ AFFINITY_MAX_CPUS ];
+    int n = Affinity_Parse( list, parsed, AFFINITY_MAX_CPUS );
+
+    if ( n <= 0 ) {
+        fprintf( stderr, warn_invalid_affinity, list );
+        return;
+    }
+    DELETE_ARRAY( *cpus );
+    *cpus = new int[ n ];
+    memcpy( *cpus, parsed, n * sizeof(int) );
+    *count = n;
+}
+
 /* -------------------------------------------------------------------
  * Parses settings from user's environment variables.
  * ------------------------------------------------------------------- */
@@ -285,7 +437,12 @@ void Settings_ParseEnvironment( thread_Settings *mSettings ) {
         theVariable = getenv( env_options[i].name );
 #endif 
         if ( theVariable != NULL ) {
-            Settings_Interpret( env_options[i].val, theVariable, mSettings );
+            if ( env_options[i].flag != NULL ) {
+                *(env_options[i].flag) = env_options[i].val;
+                Settings_Interpret( 0, theVariable, mSettings );
+            } else {
+                Settings_Interpret( env_options[i].val, theVariable, mSettings );
+            }
         }
         i++;
     }
@@ -321,14 +478,203 @@ void Settings_Interpret( char option, const char *optarg, thread_Settings *mExtS
     char outarg[100];
 
     switch ( option ) {
+        case 0: // long options without a short option equivalent
+            if ( udpbatch ) {
+                udpbatch = 0;
+                mExtSettings->mBatchSize = atoi( optarg );
+                if ( mExtSettings->mBatchSize < 1 ) {
+                    mExtSettings->mBatchSize = 1;
+                } else if ( mExtSettings->mBatchSize > kMax_BatchSize ) {
+                    fprintf( stderr, warn_batch_large, mExtSettings->mBatchSize,
+                             kMax_BatchSize );
+                    mExtSettings->mBatchSize = kMax_BatchSize;
+                }
+            }
+            if ( udpgso ) {
+                udpgso = 0;
+                if ( mExtSettings->mThreadMode != kMode_Client ) {
+                    fprintf( stderr, warn_invalid_server_long_option, "udp-gso" );
+                    break;
+                }
+                setUDPGSO( mExtSettings );
+            }
+            if ( zerocopy ) {
+                zerocopy = 0;
+                if ( mExtSettings->mThreadMode != kMode_Client ) {
+                    fprintf( stderr, warn_invalid_server_long_option, "zerocopy" );
+                    break;
+                }
+                setZeroCopy( mExtSettings );
+            }
+            if ( fileloop ) {
+                fileloop = 0;
+                if ( mExtSettings->mThreadMode != kMode_Client ) {
+                    fprintf( stderr, warn_invalid_server_long_option, "file-loop" );
+                    break;
+                }
+                setFileLoop( mExtSettings );
+            }
+            if ( filesend ) {
+                filesend = 0;
+                if ( mExtSettings->mThreadMode != kMode_Client ) {
+                    fprintf( stderr, warn_invalid_server_long_option, "sendfile" );
+                    break;
+                }
+                setSendFile( mExtSettings );
+            }
+            if ( burstsize ) {
+                burstsize = 0;
+                if ( mExtSettings->mThreadMode != kMode_Client ) {
+                    fprintf( stderr, warn_invalid_server_long_option, "burst-size" );
+                    break;
+                }
+                Settings_GetUpperCaseArg(optarg,outarg);
+                mExtSettings->mBurstSize = byte_atoi( outarg );
+            }
+            if ( fqrate ) {
+                fqrate = 0;
+                if ( mExtSettings->mThreadMode != kMode_Client ) {
+                    fprintf( stderr, warn_invalid_server_long_option, "fq-rate" );
+                    break;
+                }
+                Settings_GetLowerCaseArg(optarg,outarg);
+                mExtSettings->mFQPacingRate = byte_atoi( outarg );
+            }
+            if ( delayspin ) {
+                delayspin = 0;
+                if ( mExtSettings->mThreadMode != kMode_Client ) {
+                    fprintf( stderr, warn_invalid_server_long_option, "delay-spin" );
+                    break;
+                }
+                mExtSettings->mDelaySpin = atoi( optarg );
+            }
+            if ( isochronous ) {
+                isochronous = 0;
+                if ( mExtSettings->mThreadMode != kMode_Client ) {
+                    fprintf( stderr, warn_invalid_server_long_option, "isochronous" );
+                    break;
+                }
+                // <frames per second>[:<datagrams per frame>]
+                mExtSettings->mFrameBurst = 1;
+                if ( sscanf( optarg, "%lf:%d", &mExtSettings->mFPS, 
+                             &mExtSettings->mFrameBurst ) < 1 ||
+                     mExtSettings->mFPS <= 0 || mExtSettings->mFrameBurst < 1 ) {
+                    fprintf( stderr, warn_invalid_isochronous, optarg );
+                    break;
+                }
+                setIsochronous( mExtSettings );
+            }
+            if ( gapdist ) {
+                gapdist = 0;
+                if ( mExtSettings->mThreadMode != kMode_Client ) {
+                    fprintf( stderr, warn_invalid_server_long_option, "gap-dist" );
+                    break;
+                }
+                // <name>[:<Pareto shape>]
+                if ( strncmp( optarg, "const", 5 ) == 0 ) {
+                    mExtSettings->mGapDist = kGap_Constant;
+                } else if ( strncmp( optarg, "exp", 3 ) == 0 ||
+                            strncmp( optarg, "poisson", 7 ) == 0 ) {
+                    mExtSettings->mGapDist = kGap_Exponential;
+                } else if ( strncmp( optarg, "uniform", 7 ) == 0 ) {
+                    mExtSettings->mGapDist = kGap_Uniform;
+                } else if ( strncmp( optarg, "pareto", 6 ) == 0 ) {
+                    mExtSettings->mGapDist = kGap_Pareto;
+                    if ( strchr( optarg, ':' ) != NULL ) {
+                        mExtSettings->mGapShape = atof( strchr( optarg, ':' ) + 1 );
+                    }
+                } else {
+                    fprintf( stderr, warn_invalid_gap_dist, optarg );
+                }
+            }
+            if ( seed ) {
+                seed = 0;
+                if ( mExtSettings->mThreadMode != kMode_Client ) {
+                    fprintf( stderr, warn_invalid_server_long_option, "seed" );
+                    break;
+                }
+                mExtSettings->mSeed = strtoul( optarg, NULL, 0 );
+            }
+            if ( trace ) {
+                trace = 0;
+                if ( mExtSettings->mThreadMode != kMode_Client ) {
+                    fprintf( stderr, warn_invalid_server_long_option, "trace" );
+                    break;
+                }
+                DELETE_ARRAY( mExtSettings->mTraceName );
+                mExtSettings->mTraceName = new char[strlen(optarg)+1];
+                strcpy( mExtSettings->mTraceName, optarg );
+                setTrace( mExtSettings );
+            }
+            if ( sizemix ) {
+                sizemix = 0;
+                if ( mExtSettings->mThreadMode != kMode_Client ) {
+                    fprintf( stderr, warn_invalid_server_long_option, "size-mix" );
+                    break;
+                }
+                Settings_ParseSizeMix( mExtSettings, optarg );
+            }
+            if ( udpgro ) {
+                udpgro = 0;
+                mExtSettings->mUDPGRO = 1;
+            }
+            if ( rxstamps ) {
+                rxstamps = 0;
+                mExtSettings->mRxStamps = 1;
+            }
+            if ( txstamps ) {
+                txstamps = 0;
+                if ( mExtSettings->mThreadMode != kMode_Client ) {
+                    fprintf( stderr, warn_invalid_server_long_option, "tx-timestamps" );
+                } else {
+                    mExtSettings->mTxStamps = 1;
+                }
+            }
+            if ( workers ) {
+                workers = 0;
+                // zero picks one worker per CPU
+                mExtSettings->mWorkers = atoi( optarg );
+#ifdef _SC_NPROCESSORS_ONLN
+                if ( mExtSettings->mWorkers <= 0 ) {
+                    mExtSettings->mWorkers = (int) sysconf( _SC_NPROCESSORS_ONLN );
+                }
+#endif
+                if ( mExtSettings->mWorkers <= 0 ) {
+                    mExtSettings->mWorkers = 1;
+                }
+            }
+            if ( reuseportcpu ) {
+                reuseportcpu = 0;
+                mExtSettings->mReusePortCPU = 1;
+            }
+            if ( iouring ) {
+                iouring = 0;
+                setIOUring( mExtSettings );
+            }
+            if ( affinity ) {
+                affinity = 0;
+                Settings_ParseAffinity( optarg, &mExtSettings->mCPUs, 
+                                        &mExtSettings->mCPUCount );
+            }
+            if ( reporteraffinity ) {
+                reporteraffinity = 0;
+                Settings_ParseAffinity( optarg, &mExtSettings->mReporterCPUs, 
+                                        &mExtSettings->mReporterCPUCount );
+            }
+            if ( hugepages ) {
+                hugepages = 0;
+                mExtSettings->mHugePages = 1;
+            }
+            if ( verify ) {
+                verify = 0;
+                mExtSettings->mVerify = 1;
+            }
+            break;
+
         case '1': // Single Client
             setSingleClient( mExtSettings );
             break;
-        case 'b': // UDP bandwidth
-            if ( !isUDP( mExtSettings ) ) {
-                fprintf( stderr, warn_implied_udp, option );
-            }
-
+        case 'b': // bandwidth, UDP or rate limited TCP
             if ( mExtSettings->mThreadMode != kMode_Client ) {
                 fprintf( stderr, warn_invalid_server_option, option );
                 break;
@@ -336,13 +682,6 @@ void Settings_Interpret( char option, const char *optarg, thread_Settings *mExtS
 
             Settings_GetLowerCaseArg(optarg,outarg);
             mExtSettings->mUDPRate = byte_atoi(outarg);
-            setUDP( mExtSettings );
-
-            // if -l has already been processed, mBufLenSet is true
-            // so don't overwrite that value.
-            if ( !isBuflenSet( mExtSettings ) ) {
-                mExtSettings->mBufLen = kDefault_UDPBufLen;
-            }
             break;
 
         case 'c': // client mode w/ server host to connect to
@@ -472,8 +811,8 @@ void Settings_Interpret( char option, const char *optarg, thread_Settings *mExtS
         case 'u': // UDP instead of TCP
             // if -b has already been processed, UDP rate will
             // already be non-zero, so don't overwrite that value
-            if ( !isUDP( mExtSettings ) ) {
-                setUDP( mExtSettings );
+            setUDP( mExtSettings );
+            if ( mExtSettings->mUDPRate == 0 ) {
                 mExtSettings->mUDPRate = kDefault_UDPRate;
             }
 
@@ -726,6 +1065,7 @@ void Settings_GenerateListenerSettings( thread_Settings *client, thread_Settings
             (*listener)->mPort   = client->mPort;
         }
         (*listener)->mFileName   = NULL;
+        (*listener)->mTraceName  = NULL;
         (*listener)->mHost       = NULL;
         (*listener)->mLocalhost  = NULL;
         (*listener)->mOutputFileName = NULL;
@@ -785,6 +1125,7 @@ void Settings_GenerateClientSettings( thread_Settings *server,
             (*client)->mAmount = -(*client)->mAmount;
         }
         (*client)->mFileName   = NULL;
+        (*client)->mTraceName  = NULL;
         (*client)->mHost       = NULL;
         (*client)->mLocalhost  = NULL;
         (*client)->mOutputFileName = NULL;
@@ -823,6 +1164,9 @@ void Settings_GenerateClientHdr( thread_Settings *client, client_hdr *hdr ) {
     } else {
         hdr->flags  = 0;
     }
+    if ( isIsochronous( client ) ) {
+        hdr->flags |= htonl(HEADER_ISOCH);
+    }
     if ( isBuflenSet( client ) ) {
         hdr->bufferlen = htonl(client->mBufLen);
     } else {
@@ -0,0 +1,374 @@
+/*--------------------------------------------------------------- 
+ * Copyright (c) 1999,2000,2001,2002,2003                              
+ * The Board of Trustees of the University of Illinois            
+ * All Rights Reserved.                                           
+ *--------------------------------------------------------------- 
+ * Permission is hereby granted, free of charge, to any person    
+ * obtaining a copy of this software (Iperf) and associated       
+ * documentation files (the "Software"), to deal in the Software  
+ * without restriction, including without limitation the          
+ * rights to use, copy, modify, merge, publish, distribute,        
+ * sublicense, and/or sell copies of the Software, and to permit     
+ * persons to whom the Software is furnished to do
+ * so, subject to the following conditions: 
+ *
+ *     
+ * Redistributions of source code must retain the above 
+ * copyright notice, this list of conditions and 
+ * the following disclaimers. 
+ *
+ *     
+ * Redistributions in binary form must reproduce the above 
+ * copyright notice, this list of conditions and the following 
+ * disclaimers in the documentation and/or other materials 
+ * provided with the distribution. 
+ * 
+ *     
+ * Neither the names of the University of Illinois, NCSA, 
+ * nor the names of its contributors may be used to endorse 
+ * or promote products derived from this Software without
+ * specific prior written permission. 
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, 
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES 
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND 
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE CONTIBUTORS OR COPYRIGHT 
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, 
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, 
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE. 
+ * ________________________________________________________________
+ * National Laboratory for Applied Network Research 
+ * National Center for Supercomputing Applications 
+ * University of Illinois at Urbana-Champaign 
+ * http://www.ncsa.uiuc.edu
+ * ________________________________________________________________ 
+ * Trace.c
+ * -------------------------------------------------------------------
+ * Read a packet trace for the client to replay. Two formats are
+ * understood:
+ *
+ * Text, one record per line, "<seconds> <bytes>", separated by
+ * blanks or a comma. Seconds may be offsets or absolute times, the
+ * first record is taken as time zero. Bytes is the UDP payload.
+ * Blank lines and lines starting with # are skipped.
+ *
+ * pcap (libpcap format, either byte order, usec or nsec times). Each
+ * packet is replayed as a datagram giving an IP packet of the same
+ * length as the captured one, so only its size and time are used.
+ *
+ * Only a window of the file is mapped at a time and the window moves
+ * forward as records are read, so traces of any size are streamed
+ * through the page cache instead of being held in memory.
+ * ------------------------------------------------------------------- 
+ */
+
+#include "Trace.h"
+#include "Locale.h"
+#include "SocketAddr.h"
+
+/*
+ * Bytes of the file mapped at a time
+ */
+#define TRACE_WINDOW (16 * 1024 * 1024)
+
+/*
+ * Longest text line and pcap packet prefix looked at
+ */
+#define TRACE_LINE 256
+#define TRACE_PEEK 64
+
+#define PCAP_MAGIC      0xa1b2c3d4
+#define PCAP_MAGIC_NSEC 0xa1b23c4d
+#define PCAP_HDRLEN     24
+#define PCAP_RECLEN     16
+
+static u_int32_t Trace_swap32 ( u_int32_t x, int swap ) {
+    if ( !swap ) {
+        return x;
+    }
+    return ((x & 0xff) << 24) | ((x & 0xff00) << 8) | 
+           ((x >> 8) & 0xff00) | ((x >> 24) & 0xff);
+}
+
+/*
+ * Drop the current window, mapped or read
+ */
+static void Trace_unmap ( Trace_File *t ) {
+    if ( t->map != NULL ) {
+#if defined(HAVE_MMAP) && defined(HAVE_SYS_MMAN_H)
+        if ( t->mapped ) {
+            munmap( t->map, t->mapsize );
+        } else {
+            free( t->map );
+        }
+#else
+        free( t->map );
+#endif
+    }
+    t->map = NULL;
+    t->mapsize = 0;
+}
+
+/*
+ * Move the window so it starts at, or just before, 
+ * file offset at. Mappings must start on a page, so
+ * the window may begin a little before the offset.
+ */
+static int Trace_window ( Trace_File *t, max_size_t at ) {
+    max_size_t start = at;
+    max_size_t size;
+
+#if defined(HAVE_MMAP) && defined(HAVE_SYS_MMAN_H)
+    long page = sysconf( _SC_PAGESIZE );
+    if ( page > 0 ) {
+        start -= at % page;
+    }
+#endif
+    Trace_unmap( t );
+    t->mapstart = start;
+    t->pos = at - start;
+    if ( start >= t->filesize ) {
+        return 0;
+    }
+    size = t->filesize - start;
+    if ( size > TRACE_WINDOW ) {
+        size = TRACE_WINDOW;
+    }
+#if defined(HAVE_MMAP) && defined(HAVE_SYS_MMAN_H)
+    t->map = (char*) mmap( NULL, size, PROT_READ, MAP_SHARED, 
+                           fileno( t->file ), start );
+    if ( t->map != (char*) MAP_FAILED ) {
+        t->mapped = 1;
+        t->mapsize = size;
+#if defined(HAVE_MADVISE) && defined(MADV_SEQUENTIAL)
+        madvise( t->map, size, MADV_SEQUENTIAL );
+#endif
+        return 1;
+    }
+    t->map = NULL;
+#endif
+    // no mmap(), read the window into a buffer instead
+    t->mapped = 0;
+    t->map = (char*) malloc( size );
+    if ( t->map == NULL || fseek( t->file, start, SEEK_SET ) != 0 ||
+         fread( t->map, 1, size, t->file ) != size ) {
+        free( t->map );
+        t->map = NULL;
+        return 0;
+    }
+    t->mapsize = size;
+    return 1;
+}
+
+/*
+ * Make len bytes from the current position readable,
+ * sliding the window forward if they run past its end
+ */
+static int Trace_need ( Trace_File *t, max_size_t len ) {
+    if ( t->map != NULL && t->pos + len <= t->mapsize ) {
+        return 1;
+    }
+    if ( t->mapstart + t->pos + len > t->filesize ) {
+        return 0;
+    }
+    return Trace_window( t, t->mapstart + t->pos );
+}
+
+/*
+ * Length of the IP packet in a captured frame, taken from the
+ * IP header where it was captured, else from the frame length
+ */
+static int Trace_pcapIPLength ( Trace_File *t, u_char *pkt, int caplen, int len ) {
+    int link;
+    u_char *ip;
+
+    switch ( t->linktype ) {
+        case 0:   link = 4;  break; // BSD loopback
+        case 1:   link = 14; break; // Ethernet
+        case 113: link = 16; break; // Linux cooked
+        case 276: link = 20; break; // Linux cooked v2
+        default:  link = 0;  break; // raw IP
+    }
+    // skip any 802.1Q tags
+    while ( t->linktype == 1 && link + 4 <= caplen && 
+            ((pkt[link - 2] == 0x81 && pkt[link - 1] == 0x00) ||
+             (pkt[link - 2] == 0x88 && pkt[link - 1] == 0xa8)) ) {
+        link += 4;
+    }
+    ip = pkt + link;
+    if ( link + 4 <= caplen && (ip[0] >> 4) == 4 ) {
+        return (ip[2] << 8) | ip[3];
+    }
+    if ( link + 6 <= caplen && (ip[0] >> 4) == 6 ) {
+        return 40 + ((ip[4] << 8) | ip[5]);
+    }
+    return len - link;
+}
+
+static int Trace_pcapRecord ( Trace_File *t, double *when, int *size ) {
+    u_int32_t rec[4];
+    u_int32_t caplen, len, frac;
+    int peek;
+
+    if ( !Trace_need( t, PCAP_RECLEN ) ) {
+        return 0;
+    }
+    // records are not aligned, copy the header out
+    memcpy( rec, t->map + t->pos, sizeof(rec) );
+    frac   = Trace_swap32( rec[1], t->swap );
+    caplen = Trace_swap32( rec[2], t->swap );
+    len    = Trace_swap32( rec[3], t->swap );
+    *when  = Trace_swap32( rec[0], t->swap ) + 
+             frac / (t->nsec ? 1e9 : 1e6);
+    t->pos += PCAP_RECLEN;
+
+    peek = ( caplen < TRACE_PEEK ? caplen : TRACE_PEEK );
+    if ( !Trace_need( t, peek ) ) {
+        return 0;
+    }
+    *size = Trace_pcapIPLength( t, (u_char*) (t->map + t->pos), peek, len ) 
+            - t->overhead;
+    // skip the rest of the packet, the next record
+    // moves the window if it is past the end
+    t->pos += caplen;
+    return 1;
+}
+
+static int Trace_textRecord ( Trace_File *t, double *when, int *size ) {
+    char line[TRACE_LINE];
+    char *from;
+    char *eol;
+    char *c;
+    int len;
+
+    for ( ;; ) {
+        if ( t->map == NULL || t->pos >= t->mapsize ) {
+            if ( !Trace_window( t, t->mapstart + t->pos ) ) {
+                return 0;
+            }
+        }
+        from = t->map + t->pos;
+        eol = (char*) memchr( from, '\n', t->mapsize - t->pos );
+        if ( eol == NULL && t->mapstart + t->mapsize < t->filesize && t->pos > 0 ) {
+            // the line runs past the window, move the window to it
+            Trace_window( t, t->mapstart + t->pos );
+            continue;
+        }
+        len = ( eol == NULL ? t->mapsize - t->pos : eol - from );
+        t->pos += len + 1;
+        if ( len >= TRACE_LINE ) {
+            len = TRACE_LINE - 1;
+        }
+        memcpy( line, from, len );
+        line[len] = '\0';
+        for ( c = line; *c != '\0'; c++ ) {
+            if ( *c == ',' ) {
+                *c = ' ';
+            }
+        }
+        for ( c = line; *c == ' ' || *c == '\t'; c++ )
+            ;
+        if ( *c == '\0' || *c == '#' || *c == '\r' ) {
+            continue;
+        }
+        if ( sscanf( c, "%lf %d", when, size ) == 2 ) {
+            return 1;
+        }
+        fprintf( stderr, warn_trace_record, t->records + 1 );
+    }
+}
+
+/**
+ * Constructor
+ * @arg fileName   Name of the trace
+ * Open the trace, work out its format and
+ * map the first window
+ */
+int Trace_Initialize ( char *fileName, thread_Settings *mSettings ) {
+    Trace_File *t;
+    u_int32_t magic;
+    struct stat st;
+
+    mSettings->mTrace = NULL;
+    t = (Trace_File*) calloc( 1, sizeof(Trace_File) );
+    if ( t == NULL ) {
+        return 0;
+    }
+    if ( (t->file = fopen( fileName, "rb" )) == NULL ||
+         fstat( fileno( t->file ), &st ) != 0 || st.st_size <= 0 ) {
+        fprintf( stderr, warn_trace_open, fileName );
+        if ( t->file != NULL ) {
+            fclose( t->file );
+        }
+        free( t );
+        return 0;
+    }
+    t->filesize = st.st_size;
+    mSettings->mTrace = t;
+    if ( !Trace_window( t, 0 ) ) {
+        fprintf( stderr, warn_trace_open, fileName );
+        Trace_Destroy( mSettings );
+        return 0;
+    }
+
+    t->format = TRACE_TEXT;
+    if ( t->mapsize >= PCAP_HDRLEN ) {
+        memcpy( &magic, t->map, sizeof(magic) );
+        if ( magic == PCAP_MAGIC || Trace_swap32( magic, 1 ) == PCAP_MAGIC ||
+             magic == PCAP_MAGIC_NSEC || Trace_swap32( magic, 1 ) == PCAP_MAGIC_NSEC ) {
+            t->format = TRACE_PCAP;
+            t->swap = ( magic != PCAP_MAGIC && magic != PCAP_MAGIC_NSEC );
+            t->nsec = ( Trace_swap32( magic, t->swap ) == PCAP_MAGIC_NSEC );
+            memcpy( &magic, t->map + 20, sizeof(magic) );
+            t->linktype = Trace_swap32( magic, t->swap ) & 0xffff;
+            t->pos = PCAP_HDRLEN;
+        }
+    }
+    return 1;
+}
+
+/*
+ * Fetches the next record of the trace,
+ * with its time relative to the first
+ */
+int Trace_getNextRecord ( double *offset, int *size, thread_Settings *mSettings ) {
+    Trace_File *t = mSettings->mTrace;
+    double when;
+    int rc;
+
+    if ( t == NULL ) {
+        return 0;
+    }
+    if ( t->format == TRACE_PCAP ) {
+        // replay the IP packet length over our own socket
+        t->overhead = ( SockAddr_isIPv6( &mSettings->peer ) ? 48 : 28 );
+        rc = Trace_pcapRecord( t, &when, size );
+    } else {
+        rc = Trace_textRecord( t, &when, size );
+    }
+    if ( !rc ) {
+        return 0;
+    }
+    if ( t->records++ == 0 ) {
+        t->first = when;
+    }
+    *offset = when - t->first;
+    return 1;
+}
+
+/**
+ * Destructor - Unmap and close the trace
+ */
+void Trace_Destroy ( thread_Settings *mSettings ) {
+    Trace_File *t = mSettings->mTrace;
+
+    if ( t != NULL ) {
+        Trace_unmap( t );
+        if ( t->file != NULL ) {
+            fclose( t->file );
+        }
+        free( t );
+        mSettings->mTrace = NULL;
+    }
+}
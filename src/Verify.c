@@ -0,0 +1,283 @@
+/*--------------------------------------------------------------- 
+ * Copyright (c) 1999,2000,2001,2002,2003                              
+ * The Board of Trustees of the University of Illinois            
+ * All Rights Reserved.                                           
+ *--------------------------------------------------------------- 
+ * Permission is hereby granted, free of charge, to any person    
+ * obtaining a copy of this software (Iperf) and associated       
+ * documentation files (the "Software"), to deal in the Software  
+ * without restriction, including without limitation the          
+ * rights to use, copy, modify, merge, publish, distribute,        
+ * sublicense, and/or sell copies of the Software, and to permit     
+ * persons to whom the Software is furnished to do
+ * so, subject to the following conditions: 
+ *
+ *     
+ * Redistributions of source code must retain the above 
+ * copyright notice, this list of conditions and 
+ * the following disclaimers. 
+ *
+ *     
+ * Redistributions in binary form must reproduce the above 
+ * copyright notice, this list of conditions and the following 
+ * disclaimers in the documentation and/or other materials 
+ * provided with the distribution. 
+ * 
+ *     
+ * Neither the names of the University of Illinois, NCSA, 
+ * nor the names of its contributors may be used to endorse 
+ * or promote products derived from this Software without
+ * specific prior written permission. 
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, 
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES 
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND 
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE CONTIBUTORS OR COPYRIGHT 
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, 
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, 
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE. 
+ * ________________________________________________________________
+ * National Laboratory for Applied Network Research 
+ * National Center for Supercomputing Applications 
+ * University of Illinois at Urbana-Champaign 
+ * http://www.ncsa.uiuc.edu
+ * ________________________________________________________________ 
+ * Verify.c
+ * -------------------------------------------------------------------
+ * The CRC32C runs on the SSE4.2 crc32 instruction or the ARMv8 CRC
+ * extension when the CPU has it, eight bytes at a time, else on a
+ * table eight bytes at a time (slicing-by-8).
+ * ------------------------------------------------------------------- 
+ */
+
+#include "Verify.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <nmmintrin.h>
+#define VERIFY_SSE42
+#elif defined(__GNUC__) && defined(__aarch64__) && defined(__linux__)
+#include <arm_acle.h>
+#include <sys/auxv.h>
+#ifndef HWCAP_CRC32
+#define HWCAP_CRC32 (1 << 7)
+#endif
+#define VERIFY_ARMV8
+#endif
+
+#define VERIFY_POLY   0x82F63B78    // Castagnoli, reflected
+#define VERIFY_GOLDEN 0x9E3779B97F4A7C15ULL
+
+static u_int32_t sTable[8][256];
+static int sHardware = 0;
+
+void Verify_Initialize( void ) {
+    int i, j;
+    u_int32_t crc;
+
+    for ( i = 0; i < 256; i++ ) {
+        crc = i;
+        for ( j = 0; j < 8; j++ ) {
+            crc = (crc >> 1) ^ (VERIFY_POLY & (0 - (crc & 1)));
+        }
+        sTable[0][i] = crc;
+    }
+    for ( i = 0; i < 256; i++ ) {
+        for ( j = 1; j < 8; j++ ) {
+            sTable[j][i] = (sTable[j-1][i] >> 8) ^ sTable[0][sTable[j-1][i] & 0xFF];
+        }
+    }
+#if defined(VERIFY_SSE42)
+    __builtin_cpu_init();
+    sHardware = __builtin_cpu_supports( "sse4.2" );
+#elif defined(VERIFY_ARMV8)
+    sHardware = (getauxval( AT_HWCAP ) & HWCAP_CRC32) != 0;
+#endif
+}
+
+int Verify_Hardware( void ) {
+    return sHardware;
+}
+
+#if defined(VERIFY_SSE42)
+__attribute__((target("sse4.2")))
+static u_int32_t Verify_crcHardware( u_int32_t crc, const unsigned char *p, size_t len ) {
+#ifdef __x86_64__
+    u_int64_t crc64 = crc;
+    u_int64_t word;
+    for ( ; len >= 8; p += 8, len -= 8 ) {
+        memcpy( &word, p, 8 );
+        crc64 = _mm_crc32_u64( crc64, word );
+    }
+    crc = (u_int32_t) crc64;
+#endif
+    for ( ; len >= 4; p += 4, len -= 4 ) {
+        u_int32_t word32;
+        memcpy( &word32, p, 4 );
+        crc = _mm_crc32_u32( crc, word32 );
+    }
+    for ( ; len > 0; p++, len-- ) {
+        crc = _mm_crc32_u8( crc, *p );
+    }
+    return crc;
+}
+#elif defined(VERIFY_ARMV8)
+__attribute__((target("+crc")))
+static u_int32_t Verify_crcHardware( u_int32_t crc, const unsigned char *p, size_t len ) {
+    u_int64_t word;
+    for ( ; len >= 8; p += 8, len -= 8 ) {
+        memcpy( &word, p, 8 );
+        crc = __crc32cd( crc, word );
+    }
+    for ( ; len > 0; p++, len-- ) {
+        crc = __crc32cb( crc, *p );
+    }
+    return crc;
+}
+#endif
+
+/*
+ * Slicing-by-8, the table steps assume a little endian load
+ */
+static u_int32_t Verify_crcTable( u_int32_t crc, const unsigned char *p, size_t len ) {
+#if !defined(WORDS_BIGENDIAN)
+    u_int32_t lo, hi;
+    for ( ; len >= 8; p += 8, len -= 8 ) {
+        memcpy( &lo, p, 4 );
+        memcpy( &hi, p + 4, 4 );
+        lo ^= crc;
+        crc = sTable[7][lo & 0xFF] ^ sTable[6][(lo >> 8) & 0xFF] ^
+              sTable[5][(lo >> 16) & 0xFF] ^ sTable[4][lo >> 24] ^
+              sTable[3][hi & 0xFF] ^ sTable[2][(hi >> 8) & 0xFF] ^
+              sTable[1][(hi >> 16) & 0xFF] ^ sTable[0][hi >> 24];
+    }
+#endif
+    for ( ; len > 0; p++, len-- ) {
+        crc = (crc >> 8) ^ sTable[0][(crc ^ *p) & 0xFF];
+    }
+    return crc;
+}
+
+u_int32_t Verify_CRC32C( u_int32_t crc, const void *buf, size_t len ) {
+    crc = ~crc;
+#if defined(VERIFY_SSE42) || defined(VERIFY_ARMV8)
+    if ( sHardware ) {
+        return ~Verify_crcHardware( crc, (const unsigned char*) buf, len );
+    }
+#endif
+    return ~Verify_crcTable( crc, (const unsigned char*) buf, len );
+}
+
+/*
+ * Words derived from seq over [from, to) of buf
+ */
+static void Verify_fillWords( char *buf, long from, long to, max_size_t seq ) {
+    max_size_t word = seq * VERIFY_GOLDEN;
+    long i;
+
+    for ( i = from; i + 8 <= to; i += 8 ) {
+        memcpy( buf + i, &word, 8 );
+        word += VERIFY_GOLDEN;
+    }
+    if ( i < to ) {
+        memcpy( buf + i, &word, to - i );
+    }
+}
+
+static void Verify_fillBlock( char *block, max_size_t seq ) {
+    u_int32_t word;
+
+    word = htonl( (u_int32_t) (seq >> 32) );
+    memcpy( block, &word, 4 );
+    word = htonl( (u_int32_t) seq );
+    memcpy( block + 4, &word, 4 );
+    Verify_fillWords( block, 8, VERIFY_BLOCK - 8, seq );
+    word = htonl( VERIFY_BLOCK );
+    memcpy( block + VERIFY_BLOCK - 8, &word, 4 );
+    word = htonl( Verify_CRC32C( 0, block, VERIFY_BLOCK - 4 ) );
+    memcpy( block + VERIFY_BLOCK - 4, &word, 4 );
+}
+
+void Verify_FillStream( char *buf, long len, max_size_t offset ) {
+    char partial[ VERIFY_BLOCK ];
+    max_size_t seq = offset / VERIFY_BLOCK;
+    long at = (long) (offset % VERIFY_BLOCK);
+    long done = 0;
+
+    while ( done < len ) {
+        long n = VERIFY_BLOCK - at;
+        if ( n > len - done ) {
+            n = len - done;
+        }
+        if ( n == VERIFY_BLOCK ) {
+            Verify_fillBlock( buf + done, seq );
+        } else {
+            // the write starts or ends inside this block
+            Verify_fillBlock( partial, seq );
+            memcpy( buf + done, partial + at, n );
+        }
+        done += n;
+        at = 0;
+        seq++;
+    }
+}
+
+static void Verify_checkBlock( Verify_Stream *stream, const char *block ) {
+    u_int32_t hi, lo, size, crc;
+
+    memcpy( &hi, block, 4 );
+    memcpy( &lo, block + 4, 4 );
+    memcpy( &size, block + VERIFY_BLOCK - 8, 4 );
+    memcpy( &crc, block + VERIFY_BLOCK - 4, 4 );
+    if ( ntohl( crc ) == Verify_CRC32C( 0, block, VERIFY_BLOCK - 4 ) &&
+         ntohl( size ) == VERIFY_BLOCK &&
+         (((max_size_t) ntohl( hi )) << 32 | ntohl( lo )) == stream->seq ) {
+        stream->verified++;
+    } else {
+        stream->corrupt++;
+    }
+    stream->seq++;
+}
+
+void Verify_CheckStream( Verify_Stream *stream, const char *buf, long len ) {
+    while ( len > 0 ) {
+        long n;
+        if ( stream->fill == 0 && len >= VERIFY_BLOCK ) {
+            // a whole block in this read, check it where it is
+            Verify_checkBlock( stream, buf );
+            buf += VERIFY_BLOCK;
+            len -= VERIFY_BLOCK;
+            continue;
+        }
+        n = VERIFY_BLOCK - stream->fill;
+        if ( n > len ) {
+            n = len;
+        }
+        memcpy( stream->block + stream->fill, buf, n );
+        stream->fill += n;
+        buf += n;
+        len -= n;
+        if ( stream->fill == VERIFY_BLOCK ) {
+            Verify_checkBlock( stream, stream->block );
+            stream->fill = 0;
+        }
+    }
+}
+
+void Verify_FillDatagram( char *buf, long len, int hdrLen, u_int32_t id ) {
+    u_int32_t crc;
+
+    if ( len < hdrLen + 4 ) {
+        hdrLen = len - 4;
+    }
+    Verify_fillWords( buf, hdrLen, len - 4, id );
+    crc = htonl( Verify_CRC32C( 0, buf, len - 4 ) );
+    memcpy( buf + len - 4, &crc, 4 );
+}
+
+int Verify_CheckDatagram( const char *buf, long len ) {
+    u_int32_t crc;
+
+    memcpy( &crc, buf + len - 4, 4 );
+    return ntohl( crc ) == Verify_CRC32C( 0, buf, len - 4 );
+}
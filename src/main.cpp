@@ -70,6 +70,8 @@
 #include "Listener.hpp"
 #include "List.h"
 #include "util.h"
+#include "BufferPool.h"
+#include "Verify.h"
 
 #ifdef WIN32
 #include "service.h"
@@ -202,6 +204,10 @@ int main( int argc, char **argv ) {
     // read settings from command-line parameters
     Settings_ParseCommandLine( argc, argv, ext_gSettings );
 
+    // data buffers come from the pool, hand it --hugepages first
+    BufferPool_Initialize( ext_gSettings->mHugePages );
+    Verify_Initialize( );
+
     // Check for either having specified client or server
     if ( ext_gSettings->mThreadMode == kMode_Client 
          || ext_gSettings->mThreadMode == kMode_Listener ) {